@@ -0,0 +1,399 @@
+#ifndef MY_BOIDS_H
+#define MY_BOIDS_H
+
+#define _USE_MATH_DEFINES    // M_PI on MSVC, has to come before anything includes <cmath>
+
+#include <glm/glm.hpp>
+
+#include <my_creatures.h>
+#include <my_job_system.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// Uniform grid over 3D points, hashed into a table and rebuilt from scratch with a counting sort.
+// Points in one cell are contiguous in sortedIndices, so a query only reads the 27 cells around it.
+class SpatialHashGrid
+{
+public:
+    // Allocate for up to count points, so building never allocates
+    void reserve(unsigned int count)
+    {
+        cellStart.reserve(getTableSize(count) + 1);
+        cellCursor.reserve(getTableSize(count));
+        pointCell.reserve(count);
+        sortedIndices.reserve(count);
+    }
+
+    // Bucket the points into cells of cellSize (reuses the arrays, no allocation once they are big enough)
+    void build(const float* x, const float* y, const float* z, unsigned int count, float cellSize)
+    {
+        inverseCellSize = 1.0f / cellSize;
+        numPoints = count;
+
+        unsigned int tableSize = getTableSize(count);
+        tableMask = tableSize - 1;
+
+        cellStart.assign(tableSize + 1, 0);
+        pointCell.resize(count);
+        sortedIndices.resize(count);
+
+        // Count per bucket, prefix sum, then scatter
+        for (unsigned int i = 0; i < count; i++)
+        {
+            pointCell[i] = hashCell(cellCoord(x[i]), cellCoord(y[i]), cellCoord(z[i]));
+            cellStart[pointCell[i] + 1]++;
+        }
+        for (unsigned int h = 0; h < tableSize; h++)
+            cellStart[h + 1] += cellStart[h];
+        cellCursor.assign(cellStart.begin(), cellStart.end() - 1);
+        for (unsigned int i = 0; i < count; i++)
+            sortedIndices[cellCursor[pointCell[i]]++] = i;
+    }
+
+    // Call visit(index) for every point in the cells around a position (a superset of the points within
+    // cellSize of it). Stops early if visit returns false.
+    template <typename F>
+    void forEachNear(float px, float py, float pz, F&& visit) const
+    {
+        int cx = cellCoord(px), cy = cellCoord(py), cz = cellCoord(pz);
+
+        // Two neighbouring cells can share a bucket, visit each bucket once
+        unsigned int visited[27];
+        unsigned int numVisited = 0;
+        for (int dz = -1; dz <= 1; dz++)
+        {
+            for (int dy = -1; dy <= 1; dy++)
+            {
+                for (int dx = -1; dx <= 1; dx++)
+                {
+                    unsigned int h = hashCell(cx + dx, cy + dy, cz + dz);
+                    if (std::find(visited, visited + numVisited, h) != visited + numVisited)
+                        continue;
+                    visited[numVisited++] = h;
+
+                    for (unsigned int k = cellStart[h]; k < cellStart[h + 1]; k++)
+                    {
+                        if (!visit(sortedIndices[k]))
+                            return;
+                    }
+                }
+            }
+        }
+    }
+
+    // Nearest point to a position, searching outwards one shell of cells at a time (x, y, z are the arrays the
+    // grid was built from). Once a shell has more cells than there are points it scans every point instead.
+    // Returns false if the grid is empty.
+    bool findNearest(float px, float py, float pz, const float* x, const float* y, const float* z,
+        unsigned int& nearest, float& nearestDistance2) const
+    {
+        if (numPoints == 0)
+            return false;
+
+        int cx = cellCoord(px), cy = cellCoord(py), cz = cellCoord(pz);
+        float cellSize = 1.0f / inverseCellSize;
+        nearestDistance2 = std::numeric_limits<float>::max();
+        auto test = [&](unsigned int i)
+        {
+            float dx = x[i] - px, dy = y[i] - py, dz = z[i] - pz;
+            float distance2 = dx * dx + dy * dy + dz * dz;
+            if (distance2 < nearestDistance2)
+            {
+                nearestDistance2 = distance2;
+                nearest = i;
+            }
+        };
+
+        for (int ring = 0; ; ring++)
+        {
+            unsigned int shellCells = ring == 0 ? 1u : static_cast<unsigned int>(24 * ring * ring + 2);
+            if (shellCells > numPoints)
+            {
+                for (unsigned int i = 0; i < numPoints; i++)
+                    test(i);
+                return true;
+            }
+
+            // Cells on the surface of the cube ring cells out (far cells can share buckets, the distance test sorts it out)
+            for (int dz = -ring; dz <= ring; dz++)
+            {
+                for (int dy = -ring; dy <= ring; dy++)
+                {
+                    bool onFace = dz == -ring || dz == ring || dy == -ring || dy == ring;
+                    for (int dx = -ring; dx <= ring; dx += onFace ? 1 : 2 * ring)
+                    {
+                        unsigned int h = hashCell(cx + dx, cy + dy, cz + dz);
+                        for (unsigned int k = cellStart[h]; k < cellStart[h + 1]; k++)
+                            test(sortedIndices[k]);
+                    }
+                }
+            }
+
+            // Every point not seen yet is at least ring cells away
+            float searched = ring * cellSize;
+            if (nearestDistance2 <= searched * searched)
+                return true;
+        }
+    }
+
+private:
+    float inverseCellSize = 1.0f;
+    unsigned int tableMask = 0;
+    unsigned int numPoints = 0;
+    std::vector<unsigned int> cellStart;        // Bucket h holds sortedIndices[cellStart[h], cellStart[h + 1])
+    std::vector<unsigned int> cellCursor;
+    std::vector<unsigned int> pointCell;
+    std::vector<unsigned int> sortedIndices;
+
+    // About two buckets per point keeps collisions rare
+    static unsigned int getTableSize(unsigned int count)
+    {
+        unsigned int tableSize = 64;
+        while (tableSize < count * 2)
+            tableSize *= 2;
+        return tableSize;
+    }
+
+    int cellCoord(float value) const
+    {
+        return static_cast<int>(std::floor(value * inverseCellSize));
+    }
+
+    unsigned int hashCell(int x, int y, int z) const
+    {
+        return ((static_cast<unsigned int>(x) * 73856093u) ^ (static_cast<unsigned int>(y) * 19349663u)
+            ^ (static_cast<unsigned int>(z) * 83492791u)) & tableMask;
+    }
+};
+
+// Tuning of a school (distances in world units, speeds per second)
+struct BoidParams
+{
+    float neighborRadius = 0.6f;        // Alignment and cohesion range, also the grid cell size
+    float separationRadius = 0.25f;
+    unsigned int maxNeighbors = 24;     // Enough for the flocking rules, bounds the cost in dense spots
+    float separationWeight = 1.5f;
+    float alignmentWeight = 1.0f;
+    float cohesionWeight = 0.8f;
+    float minSpeed = 0.3f;
+    float maxSpeed = 0.6f;
+    float maxAcceleration = 2.0f;
+    float verticalDamping = 0.5f;       // Fish mostly swim level
+    glm::vec3 boundsMin = glm::vec3(-5.25f, 0.3f, -5.25f);
+    glm::vec3 boundsMax = glm::vec3(5.25f, 3.0f, 5.25f);
+    float boundaryMargin = 0.6f;        // Turning starts this far from the tank walls
+    float boundaryWeight = 4.0f;
+    float obstacleMargin = 0.3f;
+    float obstacleWeight = 6.0f;
+};
+
+// Neighbour search counters of the last step
+struct BoidStats
+{
+    unsigned long long candidatesTested = 0;    // Points returned by the grid (or all points when brute force)
+    unsigned long long neighborsFound = 0;
+};
+
+// Schooling (separation, alignment, cohesion) plus tank wall and obstacle avoidance for one fish population.
+// Positions and headings are written into the FishArchetype arrays, so its matrix building and drawing don't change.
+class BoidSchool
+{
+public:
+    BoidParams params;
+    bool bruteForceNeighbors = false;   // Test every pair instead of using the grid (for benchmarking)
+
+    // Constructor (the fish must already be added, each starts swimming the way it faces)
+    BoidSchool(FishArchetype& fish)
+        : fish(&fish)
+    {
+        unsigned int count = fish.size();
+        vx.resize(count); vy.resize(count); vz.resize(count);
+        nextVx.resize(count); nextVy.resize(count); nextVz.resize(count);
+        float speed = 0.5f * (params.minSpeed + params.maxSpeed);
+        for (unsigned int i = 0; i < count; i++)
+        {
+            // Inverse of the heading written in integrate
+            vx[i] = std::cos(-fish.yaw[i]) * speed;
+            vy[i] = 0.0f;
+            vz[i] = std::sin(-fish.yaw[i]) * speed;
+        }
+    }
+
+    // Add a sphere the fish steer around (a rock)
+    void addObstacle(const glm::vec3& center, float radius)
+    {
+        obstacles.push_back(glm::vec4(center, radius));
+    }
+
+    // Simulation step: rebuild the grid, steer every fish, then move them
+    void step(float stepSeconds, JobSystem& jobs)
+    {
+        const unsigned int count = fish->size();
+        if (!bruteForceNeighbors)
+            grid.build(fish->x.data(), fish->y.data(), fish->z.data(), count, params.neighborRadius);
+
+        candidatesTested = 0;
+        neighborsFound = 0;
+        jobs.parallelFor(count, CREATURE_UPDATE_GRAIN, [this, stepSeconds](unsigned int begin, unsigned int end)
+        {
+            steer(stepSeconds, begin, end);
+        });
+        jobs.parallelFor(count, CREATURE_UPDATE_GRAIN, [this, stepSeconds](unsigned int begin, unsigned int end)
+        {
+            integrate(stepSeconds, begin, end);
+        });
+    }
+
+    // Push one fish for a step on top of the flocking rules (for other systems, e.g. fish going for food)
+    void accelerate(unsigned int i, const glm::vec3& acceleration, float stepSeconds)
+    {
+        vx[i] += acceleration.x * stepSeconds;
+        vy[i] += acceleration.y * stepSeconds;
+        vz[i] += acceleration.z * stepSeconds;
+    }
+
+    const FishArchetype& getFish() const
+    {
+        return *fish;
+    }
+
+    BoidStats getStats() const
+    {
+        BoidStats stats;
+        stats.candidatesTested = candidatesTested.load();
+        stats.neighborsFound = neighborsFound.load();
+        return stats;
+    }
+
+private:
+    FishArchetype* fish;
+    SpatialHashGrid grid;
+    std::vector<glm::vec4> obstacles;           // xyz centre, w radius
+    AlignedArray<float> vx, vy, vz;             // Velocity
+    AlignedArray<float> nextVx, nextVy, nextVz; // Velocity after steering, swapped in by integrate
+    std::atomic<unsigned long long> candidatesTested{ 0 };
+    std::atomic<unsigned long long> neighborsFound{ 0 };
+
+    // New velocities of fish [begin, end) from the current positions and velocities of the school
+    void steer(float stepSeconds, unsigned int begin, unsigned int end)
+    {
+        const float* px = fish->x.data();
+        const float* py = fish->y.data();
+        const float* pz = fish->z.data();
+        const float neighborRadius2 = params.neighborRadius * params.neighborRadius;
+        const float separationRadius2 = params.separationRadius * params.separationRadius;
+        unsigned long long rangeCandidates = 0, rangeNeighbors = 0;
+
+        for (unsigned int i = begin; i < end; i++)
+        {
+            glm::vec3 position(px[i], py[i], pz[i]);
+            glm::vec3 velocity(vx[i], vy[i], vz[i]);
+            glm::vec3 separation(0.0f), alignment(0.0f), cohesion(0.0f);
+            unsigned int numNeighbors = 0;
+
+            auto visit = [&](unsigned int j)
+            {
+                rangeCandidates++;
+                if (j == i)
+                    return true;
+                glm::vec3 offset(position.x - px[j], position.y - py[j], position.z - pz[j]);
+                float distance2 = glm::dot(offset, offset);
+                if (distance2 >= neighborRadius2)
+                    return true;
+
+                alignment += glm::vec3(vx[j], vy[j], vz[j]);
+                cohesion += glm::vec3(px[j], py[j], pz[j]);
+                if (distance2 < separationRadius2)
+                    separation += offset / std::max(distance2, 1e-4f);
+                return ++numNeighbors < params.maxNeighbors;
+            };
+            if (bruteForceNeighbors)
+            {
+                for (unsigned int j = 0; j < fish->size(); j++)
+                {
+                    if (!visit(j))
+                        break;
+                }
+            }
+            else
+                grid.forEachNear(position.x, position.y, position.z, visit);
+            rangeNeighbors += numNeighbors;
+
+            // Flocking rules
+            glm::vec3 acceleration = separation * params.separationWeight;
+            if (numNeighbors > 0)
+            {
+                acceleration += (alignment / float(numNeighbors) - velocity) * params.alignmentWeight;
+                acceleration += (cohesion / float(numNeighbors) - position) * params.cohesionWeight;
+            }
+
+            // Turn back from the tank walls, harder the closer they are
+            for (int axis = 0; axis < 3; axis++)
+            {
+                float low = params.boundsMin[axis] + params.boundaryMargin - position[axis];
+                float high = position[axis] - (params.boundsMax[axis] - params.boundaryMargin);
+                if (low > 0.0f)
+                    acceleration[axis] += params.boundaryWeight * low / params.boundaryMargin;
+                if (high > 0.0f)
+                    acceleration[axis] -= params.boundaryWeight * high / params.boundaryMargin;
+            }
+
+            // Push away from obstacles
+            for (const glm::vec4& obstacle : obstacles)
+            {
+                glm::vec3 away = position - glm::vec3(obstacle);
+                float distance = glm::length(away);
+                float depth = obstacle.w + params.obstacleMargin - distance;
+                if (depth > 0.0f && distance > 1e-4f)
+                    acceleration += away / distance * (params.obstacleWeight * depth / params.obstacleMargin);
+            }
+
+            float accelerationLength = glm::length(acceleration);
+            if (accelerationLength > params.maxAcceleration)
+                acceleration *= params.maxAcceleration / accelerationLength;
+
+            velocity += acceleration * stepSeconds;
+            velocity.y *= 1.0f - std::min(1.0f, params.verticalDamping * stepSeconds);
+            float speed = glm::length(velocity);
+            if (speed > 1e-4f)
+                velocity *= glm::clamp(speed, params.minSpeed, params.maxSpeed) / speed;
+
+            nextVx[i] = velocity.x;
+            nextVy[i] = velocity.y;
+            nextVz[i] = velocity.z;
+        }
+
+        candidatesTested.fetch_add(rangeCandidates);
+        neighborsFound.fetch_add(rangeNeighbors);
+    }
+
+    // Move fish [begin, end) with their new velocities and face them along it
+    void integrate(float stepSeconds, unsigned int begin, unsigned int end)
+    {
+        fish->storePreviousPose(begin, end);
+
+        float* px = fish->x.data();
+        float* py = fish->y.data();
+        float* pz = fish->z.data();
+        float* heading = fish->yaw.data();
+        for (unsigned int i = begin; i < end; i++)
+        {
+            vx[i] = nextVx[i];
+            vy[i] = nextVy[i];
+            vz[i] = nextVz[i];
+            px[i] += vx[i] * stepSeconds;
+            py[i] += vy[i] * stepSeconds;
+            pz[i] += vz[i] * stepSeconds;
+
+            // Heading unwrapped around the last one, so interpolating it never spins the long way round
+            float target = -std::atan2(vz[i], vx[i]);
+            float turn = std::remainder(target - heading[i], 2.0f * float(M_PI));
+            heading[i] += turn;
+        }
+    }
+};
+#endif // MY_BOIDS_H
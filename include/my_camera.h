@@ -110,6 +110,15 @@ public:
         WALL_Z_MAX = constraints[3];
     }
 
+    // Place the camera directly (for replays and scripted paths, no constraints applied)
+    void setPose(const glm::vec3& position, const float yaw, const float pitch)
+    {
+        this->position = position;
+        this->yaw = yaw;
+        this->pitch = pitch;
+        updateCameraVectors();
+    }
+
     // Set zoom
     void setZoom(const float zoom)
     {
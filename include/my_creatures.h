@@ -0,0 +1,412 @@
+#ifndef MY_CREATURES_H
+#define MY_CREATURES_H
+
+#define _USE_MATH_DEFINES    // M_PI on MSVC, has to come before anything includes <cmath>
+
+#include <glm/glm.hpp>
+
+#include <my_job_system.h>
+#include <my_pose_kernel.h>
+#include <my_swim_batch.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// Alignment of the creature arrays (one AVX register)
+const std::size_t CREATURE_ARRAY_ALIGNMENT = 32;
+
+// Allocator handing out CREATURE_ARRAY_ALIGNMENT aligned blocks
+template <typename T>
+class AlignedAllocator
+{
+public:
+    using value_type = T;
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U>&) {}
+
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(CREATURE_ARRAY_ALIGNMENT)));
+    }
+
+    void deallocate(T* p, std::size_t)
+    {
+        ::operator delete(p, std::align_val_t(CREATURE_ARRAY_ALIGNMENT));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U>&) const { return false; }
+};
+
+// Contiguous, aligned array of one creature attribute
+template <typename T>
+using AlignedArray = std::vector<T, AlignedAllocator<T>>;
+
+// Structure of arrays holding one population of creatures: index i is the same creature in every array.
+// Poses are translation plus yaw (the populations never pitch or roll). The pose before the last simulation
+// step is kept too, so world matrices can be built anywhere between the two.
+class CreaturePopulation
+{
+public:
+    AlignedArray<float> x, y, z;
+    AlignedArray<float> yaw;
+    AlignedArray<float> prevX, prevY, prevZ;    // Pose before the last simulation step
+    AlignedArray<float> prevYaw;
+    AlignedArray<float> phase;                  // Animation offset of each creature
+    AlignedArray<float> radius;                 // Distance from the tank's vertical axis
+    AlignedArray<glm::mat4> worldMatrices;      // segmentsPerCreature matrices per creature
+
+    unsigned int size() const
+    {
+        return static_cast<unsigned int>(x.size());
+    }
+
+    // Number of world matrices each creature owns (one per independently posed mesh)
+    unsigned int getSegmentsPerCreature() const
+    {
+        return segmentsPerCreature;
+    }
+
+    // World matrix of a creature's segment
+    const glm::mat4& getWorldMatrix(unsigned int creature, unsigned int segment = 0) const
+    {
+        return worldMatrices[creature * segmentsPerCreature + segment];
+    }
+
+    // Reserve room for a population size
+    void reserve(unsigned int count)
+    {
+        x.reserve(count); y.reserve(count); z.reserve(count); yaw.reserve(count);
+        prevX.reserve(count); prevY.reserve(count); prevZ.reserve(count); prevYaw.reserve(count);
+        phase.reserve(count); radius.reserve(count);
+        sinYaw.reserve(count); cosYaw.reserve(count);
+        worldMatrices.reserve(count * segmentsPerCreature);
+    }
+
+    // Add a creature, returns its index
+    unsigned int add(float posX, float posY, float posZ, float yawAngle, float phaseOffset = 0.0f)
+    {
+        x.push_back(posX); y.push_back(posY); z.push_back(posZ); yaw.push_back(yawAngle);
+        prevX.push_back(posX); prevY.push_back(posY); prevZ.push_back(posZ); prevYaw.push_back(yawAngle);
+        phase.push_back(phaseOffset);
+        radius.push_back(std::sqrt(posX * posX + posZ * posZ));
+        sinYaw.push_back(0.0f); cosYaw.push_back(0.0f);
+        worldMatrices.resize(worldMatrices.size() + segmentsPerCreature, glm::mat4(1.0f));
+        return size() - 1;
+    }
+
+    // Keep the current pose of creatures [begin, end) as the previous one, at the start of a simulation step
+    void storePreviousPose(unsigned int begin, unsigned int end)
+    {
+        std::copy(x.begin() + begin, x.begin() + end, prevX.begin() + begin);
+        std::copy(y.begin() + begin, y.begin() + end, prevY.begin() + begin);
+        std::copy(z.begin() + begin, z.begin() + end, prevZ.begin() + begin);
+        std::copy(yaw.begin() + begin, yaw.begin() + end, prevYaw.begin() + begin);
+    }
+
+    // Rebuild all world matrices from the current pose
+    void buildWorldMatrices()
+    {
+        buildWorldMatrixRange(0, size());
+    }
+
+    // Rebuild the world matrices of creatures [begin, end) (translate, then rotate about Y) from the pose
+    // alpha of the way from the previous to the current one. Each segment adds its own yaw offset.
+    // Separate ranges can be built on separate threads.
+    void buildWorldMatrixRange(unsigned int begin, unsigned int end, float alpha = 1.0f, const float* segmentYawOffsets = nullptr)
+    {
+        const unsigned int count = end - begin;
+        const float* posX = x.data();
+        const float* posY = y.data();
+        const float* posZ = z.data();
+        const float* baseYaw = yaw.data();
+        const float* fromX = prevX.data();
+        const float* fromY = prevY.data();
+        const float* fromZ = prevZ.data();
+        const float* fromYaw = prevYaw.data();
+        float* sines = sinYaw.data();
+        float* cosines = cosYaw.data();
+
+        for (unsigned int s = 0; s < segmentsPerCreature; s++)
+        {
+            const float offset = segmentYawOffsets ? segmentYawOffsets[s] : 0.0f;
+
+            // Trigonometry first, over the whole array with the vector kernel
+            for (unsigned int i = begin; i < end; i++)
+                sines[i] = fromYaw[i] + (baseYaw[i] - fromYaw[i]) * alpha + offset;
+            computeSinCos(sines + begin, sines + begin, cosines + begin, count);
+
+            // Closed form of translate * rotateY, written straight into the matrix columns
+            glm::mat4* matrices = worldMatrices.data() + s;
+            for (unsigned int i = begin; i < end; i++)
+            {
+                glm::mat4& m = matrices[i * segmentsPerCreature];
+                m[0] = glm::vec4(cosines[i], 0.0f, -sines[i], 0.0f);
+                m[1] = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
+                m[2] = glm::vec4(sines[i], 0.0f, cosines[i], 0.0f);
+                m[3] = glm::vec4(fromX[i] + (posX[i] - fromX[i]) * alpha, fromY[i] + (posY[i] - fromY[i]) * alpha,
+                    fromZ[i] + (posZ[i] - fromZ[i]) * alpha, 1.0f);
+            }
+        }
+    }
+
+protected:
+    unsigned int segmentsPerCreature = 1;
+
+    // Must be set before any creature is added
+    void setSegmentsPerCreature(unsigned int segments)
+    {
+        segmentsPerCreature = segments > 0 ? segments : 1;
+    }
+
+private:
+    // Scratch columns for buildWorldMatrixRange
+    AlignedArray<float> sinYaw, cosYaw;
+};
+
+// Fish orbit the tank's vertical axis at their own radius and height, each segment wagging with its own phase
+class FishArchetype : public CreaturePopulation
+{
+public:
+    float angularSpeed = 0.1f;      // Orbit speed (radians per second)
+    float wagAmplitude = 0.1f;
+    float wagFrequency = 5.0f;
+    float segmentWagPhase = 5.0f;   // Phase step between successive segments
+
+    // Constructor (number of meshes in the fish model)
+    FishArchetype(unsigned int numSegments = 1)
+    {
+        setSegmentsPerCreature(numSegments);
+        segmentWag.resize(segmentsPerCreature);
+    }
+
+    // Simulation step: move fish [begin, end) to their place on the orbit at time
+    void update(float time, unsigned int begin, unsigned int end)
+    {
+        storePreviousPose(begin, end);
+
+        const float* orbitRadius = radius.data();
+        const float* orbitPhase = phase.data();
+        float* posX = x.data();
+        float* posZ = z.data();
+        float* heading = yaw.data();
+        for (unsigned int i = begin; i < end; i++)
+        {
+            float theta = time * angularSpeed + orbitPhase[i];
+            posX[i] = orbitRadius[i] * std::cos(theta);
+            posZ[i] = orbitRadius[i] * std::sin(theta);
+            heading[i] = 1.5f * float(M_PI) - theta;
+        }
+    }
+
+    // Values shared by all fish for the frame being drawn, call once before building ranges
+    void prepareMatrices(float renderTime)
+    {
+        // The wag is the same for every fish, only the segment changes it
+        for (unsigned int s = 0; s < segmentsPerCreature; s++)
+            segmentWag[s] = wagAmplitude * std::sin(renderTime * wagFrequency + s * segmentWagPhase);
+    }
+
+    // World matrices of fish [begin, end), alpha of the way through the last step (after prepareMatrices)
+    void buildMatrices(float alpha, unsigned int begin, unsigned int end)
+    {
+        buildWorldMatrixRange(begin, end, alpha, segmentWag.data());
+    }
+
+    // Orbit constants for posing the same fish on the GPU
+    std::vector<SwimInstance> getSwimInstances() const
+    {
+        std::vector<SwimInstance> instances;
+        instances.reserve(size());
+        for (unsigned int i = 0; i < size(); i++)
+            instances.push_back({ radius[i], phase[i], y[i], angularSpeed });
+        return instances;
+    }
+
+private:
+    std::vector<float> segmentWag;
+};
+
+// Jellyfish bob up and down in place while slowly spinning
+class JellyfishArchetype : public CreaturePopulation
+{
+public:
+    float bobAmplitude = 0.5f;
+    float bobFrequency = 0.5f;
+    float bobHeight = 1.5f;                         // Centre of the bob
+    float spinSpeed = glm::radians(18.0f);          // Radians per second
+
+    // Simulation step: bob and spin jellyfish [begin, end) to time, stepSeconds after the last step
+    void update(float time, float stepSeconds, unsigned int begin, unsigned int end)
+    {
+        storePreviousPose(begin, end);
+
+        const float* bobPhase = phase.data();
+        float* posY = y.data();
+        float* heading = yaw.data();
+        for (unsigned int i = begin; i < end; i++)
+        {
+            posY[i] = bobAmplitude * std::sin(time * bobFrequency + bobPhase[i]) + bobHeight;
+            heading[i] += spinSpeed * stepSeconds;
+        }
+    }
+
+    // World matrices of jellyfish [begin, end), alpha of the way through the last step
+    void buildMatrices(float alpha, unsigned int begin, unsigned int end)
+    {
+        buildWorldMatrixRange(begin, end, alpha);
+    }
+};
+
+// Kelp stalks are rooted in place, their sway is done in the vertex shader
+class KelpArchetype : public CreaturePopulation
+{
+public:
+    // Root matrices only change when stalks are added
+    void update()
+    {
+        buildWorldMatrices();
+    }
+};
+
+// Sharks circle the tank like fish, but can break off to chase a target
+class SharkArchetype : public CreaturePopulation
+{
+public:
+    float angularSpeed = 0.1f;      // Orbit speed (radians per second)
+    float chaseSpeed = 0.3f;        // Units per second while chasing
+    float turnSpeed = 0.06f;        // Radians per second while chasing
+    float catchDistance = 0.1f;
+    float wagAmplitude = 0.1f;
+    float wagFrequency = 5.0f;
+    float segmentWagPhase = 5.0f;
+
+    // Constructor (number of meshes in the shark model)
+    SharkArchetype(unsigned int numSegments = 1)
+    {
+        setSegmentsPerCreature(numSegments);
+        segmentWag.resize(segmentsPerCreature);
+    }
+
+    // Simulation step: every shark circles at its current radius
+    void orbit(float time)
+    {
+        for (unsigned int i = 0; i < size(); i++)
+            orbit(time, i);
+    }
+
+    // Simulation step: one shark circles at its current radius
+    void orbit(float time, unsigned int shark)
+    {
+        storePreviousPose(shark, shark + 1);
+        float theta = time * angularSpeed + phase[shark];
+        x[shark] = radius[shark] * std::cos(theta);
+        z[shark] = radius[shark] * std::sin(theta);
+        yaw[shark] = 1.5f * float(M_PI) - theta;
+    }
+
+    // Simulation step: swim one shark towards a target, returns true when it gets there (it then orbits at its new radius)
+    bool chase(unsigned int shark, const glm::vec3& target, float stepSeconds)
+    {
+        storePreviousPose(shark, shark + 1);
+
+        glm::vec3 direction = target - glm::vec3(x[shark], y[shark], z[shark]);
+        float distance = glm::length(direction);
+        if (distance < catchDistance)
+        {
+            radius[shark] = std::sqrt(x[shark] * x[shark] + z[shark] * z[shark]);
+            return true;
+        }
+
+        direction /= distance;
+        float step = std::min(chaseSpeed * stepSeconds, distance);
+        x[shark] += direction.x * step;
+        y[shark] += direction.y * step;
+        z[shark] += direction.z * step;
+
+        // Slowly turn towards the target
+        float targetYaw = std::atan2(direction.z, direction.x) + float(M_PI);
+        yaw[shark] += ((targetYaw - yaw[shark]) < 0.0f ? -turnSpeed : turnSpeed) * stepSeconds;
+        return false;
+    }
+
+    // World matrices of every shark for the frame being drawn
+    void buildMatrices(float renderTime, float alpha)
+    {
+        for (unsigned int s = 0; s < segmentsPerCreature; s++)
+            segmentWag[s] = wagAmplitude * std::sin(renderTime * wagFrequency + s * segmentWagPhase);
+        buildWorldMatrixRange(0, size(), alpha, segmentWag.data());
+    }
+
+private:
+    std::vector<float> segmentWag;
+};
+
+// Creatures per job when a population is updated in parallel
+const unsigned int CREATURE_UPDATE_GRAIN = 256;
+
+// Every animated population in the tank, plus the rocks (static, posed once)
+struct CreatureStore
+{
+    FishArchetype fish1;
+    FishArchetype fish2;
+    JellyfishArchetype jellyfish1;
+    JellyfishArchetype jellyfish2;
+    KelpArchetype kelp;
+    SharkArchetype shark;
+    CreaturePopulation rocks;
+
+    // Simulation step of the large populations across the job system's threads (fish only if they are posed
+    // on the CPU). The shark is a single creature with its own logic and is stepped by the caller.
+    void update(float time, float stepSeconds, JobSystem& jobs, bool updateFish = true)
+    {
+        if (updateFish)
+        {
+            for (FishArchetype* fish : { &fish1, &fish2 })
+            {
+                jobs.parallelFor(fish->size(), CREATURE_UPDATE_GRAIN, [fish, time](unsigned int begin, unsigned int end)
+                {
+                    fish->update(time, begin, end);
+                });
+            }
+        }
+        for (JellyfishArchetype* jellyfish : { &jellyfish1, &jellyfish2 })
+        {
+            jobs.parallelFor(jellyfish->size(), CREATURE_UPDATE_GRAIN, [jellyfish, time, stepSeconds](unsigned int begin, unsigned int end)
+            {
+                jellyfish->update(time, stepSeconds, begin, end);
+            });
+        }
+    }
+
+    // World matrices of the large populations for the frame being drawn, alpha of the way through the last step
+    void buildMatrices(float renderTime, float alpha, JobSystem& jobs, bool buildFish = true)
+    {
+        if (buildFish)
+        {
+            for (FishArchetype* fish : { &fish1, &fish2 })
+            {
+                fish->prepareMatrices(renderTime);
+                jobs.parallelFor(fish->size(), CREATURE_UPDATE_GRAIN, [fish, alpha](unsigned int begin, unsigned int end)
+                {
+                    fish->buildMatrices(alpha, begin, end);
+                });
+            }
+        }
+        for (JellyfishArchetype* jellyfish : { &jellyfish1, &jellyfish2 })
+        {
+            jobs.parallelFor(jellyfish->size(), CREATURE_UPDATE_GRAIN, [jellyfish, alpha](unsigned int begin, unsigned int end)
+            {
+                jellyfish->buildMatrices(alpha, begin, end);
+            });
+        }
+    }
+};
+#endif // MY_CREATURES_H
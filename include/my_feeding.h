@@ -0,0 +1,337 @@
+#ifndef MY_FEEDING_H
+#define MY_FEEDING_H
+
+#include <glm/glm.hpp>
+
+#include <my_boids.h>
+#include <my_creatures.h>
+#include <my_job_system.h>
+
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Tuning of the feeding (distances in world units, speeds per second)
+struct FeedingParams
+{
+    unsigned int capacity = 256;        // Most pellets in the tank at once, drops beyond it are ignored
+    glm::vec3 dropPosition = glm::vec3(4.0f, 2.5f, 4.0f);
+    float dropSpread = 0.75f;           // Each drop lands somewhere within this of the drop position
+    float sinkSpeed = 0.1f;
+    float floorHeight = 0.0f;           // Pellets left uneaten dissolve here
+    float fishSenseRadius = 0.8f;       // Fish notice pellets this close, also the grid cell size
+    float fishBiteDistance = 0.1f;
+    float fishAttraction = 1.5f;        // Pull towards the nearest pellet on top of the flocking rules
+    unsigned int seed = 1234;
+};
+
+// A pellet that has just been dropped (its generation tells a later pellet in the same slot apart)
+struct PelletDrop
+{
+    unsigned int slot;
+    unsigned int generation;
+};
+
+// What happened to the pellets so far
+struct FeedingStats
+{
+    unsigned long long dropped = 0;
+    unsigned long long rejected = 0;    // Drops while the pool was full
+    unsigned long long eatenBySharks = 0;
+    unsigned long long eatenByFish = 0;
+    unsigned long long dissolved = 0;
+};
+
+// Food pellets sinking through the tank, and the predators going for them.
+// Pellets live in a fixed pool (slots recycled through a free list) and every step the live ones are indexed
+// in a spatial hash grid, which each shark and fish asks for its nearest pellet. Nothing allocates after
+// construction, however many drops there are. Fish feed in parallel but only see the bites of earlier passes,
+// and a pellet several fish reach goes to the lowest fish index, so a seed always gives the same run.
+class FeedingSystem
+{
+public:
+    FeedingParams params;
+
+    // Constructor (allocates the pool, so the capacity can't change later)
+    FeedingSystem(const FeedingParams& feedingParams = FeedingParams())
+        : params(feedingParams), random(feedingParams.seed), fishClaims(new std::atomic<unsigned int>[feedingParams.capacity])
+    {
+        unsigned int capacity = params.capacity;
+        x.resize(capacity); y.resize(capacity); z.resize(capacity);
+        prevY.resize(capacity);
+        generations.resize(capacity, 0);
+        eatenBy.resize(capacity, 0);
+        newDrops.reserve(capacity);
+        liveSlots.reserve(capacity);
+        liveIndex.resize(capacity);
+        freeSlots.reserve(capacity);
+        for (unsigned int slot = capacity; slot > 0; slot--)
+            freeSlots.push_back(slot - 1);
+        indexX.resize(capacity); indexY.resize(capacity); indexZ.resize(capacity);
+        grid.reserve(capacity);
+        for (unsigned int slot = 0; slot < capacity; slot++)
+            fishClaims[slot].store(NO_CLAIM);
+    }
+
+    // Sharks steering for the nearest pellet (they orbit when there is none)
+    void addSharks(SharkArchetype& sharks)
+    {
+        predatorSharks.push_back(&sharks);
+    }
+
+    // A school whose fish pick off pellets that come close
+    void addSchool(BoidSchool& school)
+    {
+        predatorSchools.push_back(&school);
+    }
+
+    // Drop one pellet near the drop position, returns false if the pool is full
+    bool drop()
+    {
+        if (freeSlots.empty())
+        {
+            stats.rejected++;
+            return false;
+        }
+
+        unsigned int slot = freeSlots.back();
+        freeSlots.pop_back();
+        std::uniform_real_distribution<float> spread(-params.dropSpread, params.dropSpread);
+        x[slot] = params.dropPosition.x + spread(random);
+        y[slot] = params.dropPosition.y;
+        z[slot] = params.dropPosition.z + spread(random);
+        prevY[slot] = y[slot];
+        eatenBy[slot] = 0;
+        liveIndex[slot] = static_cast<unsigned int>(liveSlots.size());
+        liveSlots.push_back(slot);
+        if (newDrops.size() < params.capacity)
+            newDrops.push_back({ slot, generations[slot] });
+        stats.dropped++;
+        return true;
+    }
+
+    // Simulation step: sink the pellets, index them, let every predator go for its nearest one, recycle the eaten
+    void step(float time, float stepSeconds, JobSystem& jobs)
+    {
+        sink(stepSeconds);
+        buildIndex();
+
+        for (SharkArchetype* sharks : predatorSharks)
+            feedSharks(*sharks, time, stepSeconds);
+        for (BoidSchool* school : predatorSchools)
+        {
+            jobs.parallelFor(school->getFish().size(), CREATURE_UPDATE_GRAIN, [this, school, stepSeconds](unsigned int begin, unsigned int end)
+            {
+                feedSchool(*school, stepSeconds, begin, end);
+            });
+            applyFishBites();
+        }
+
+        // Recycle the pellets that were eaten (backwards, removing swaps the last live pellet in)
+        for (unsigned int k = static_cast<unsigned int>(liveSlots.size()); k > 0; k--)
+        {
+            unsigned int slot = liveSlots[k - 1];
+            unsigned int eater = eatenBy[slot];
+            if (eater == 0)
+                continue;
+            if (eater == EATEN_BY_SHARK)
+                stats.eatenBySharks++;
+            else
+                stats.eatenByFish++;
+            release(slot);
+        }
+    }
+
+    // Pellets in the tank
+    unsigned int size() const
+    {
+        return static_cast<unsigned int>(liveSlots.size());
+    }
+
+    // Position of the k-th pellet in the tank, alpha of the way through the last step
+    glm::vec3 getPelletPosition(unsigned int k, float alpha) const
+    {
+        unsigned int slot = liveSlots[k];
+        return glm::vec3(x[slot], prevY[slot] + (y[slot] - prevY[slot]) * alpha, z[slot]);
+    }
+
+    // Pellets dropped since clearNewDrops, for spawning whatever draws them
+    const std::vector<PelletDrop>& getNewDrops() const
+    {
+        return newDrops;
+    }
+
+    void clearNewDrops()
+    {
+        newDrops.clear();
+    }
+
+    // Whether a dropped pellet is still in the tank
+    bool isInTank(const PelletDrop& drop) const
+    {
+        return generations[drop.slot] == drop.generation;
+    }
+
+    // Position of a pellet by slot, as of the last step
+    glm::vec3 getSlotPosition(unsigned int slot) const
+    {
+        return glm::vec3(x[slot], y[slot], z[slot]);
+    }
+
+    // Generation of every slot, bumped each time its pellet goes (capacity entries)
+    const unsigned int* getGenerations() const
+    {
+        return generations.data();
+    }
+
+    const FeedingStats& getStats() const
+    {
+        return stats;
+    }
+
+private:
+    static const unsigned int EATEN_BY_SHARK = 1;
+    static const unsigned int EATEN_BY_FISH = 2;
+    static const unsigned int NO_CLAIM = std::numeric_limits<unsigned int>::max();
+
+    std::mt19937 random;
+    FeedingStats stats;
+
+    // Pool, indexed by slot
+    AlignedArray<float> x, y, z;
+    AlignedArray<float> prevY;
+    std::vector<unsigned int> eatenBy;          // 0, or who ate it, only written between the parallel passes
+    std::unique_ptr<std::atomic<unsigned int>[]> fishClaims;    // Lowest index of the fish biting it this pass, or NO_CLAIM
+    std::vector<unsigned int> liveSlots;        // Slots in use, in no particular order
+    std::vector<unsigned int> liveIndex;        // Where each used slot is in liveSlots
+    std::vector<unsigned int> freeSlots;
+    std::vector<unsigned int> generations;
+    std::vector<PelletDrop> newDrops;
+
+    // Live pellet positions packed for the grid, grid index k is liveSlots[k]
+    AlignedArray<float> indexX, indexY, indexZ;
+    SpatialHashGrid grid;
+
+    std::vector<SharkArchetype*> predatorSharks;
+    std::vector<BoidSchool*> predatorSchools;
+
+    // Return a slot to the pool
+    void release(unsigned int slot)
+    {
+        unsigned int k = liveIndex[slot];
+        unsigned int last = liveSlots.back();
+        liveSlots[k] = last;
+        liveIndex[last] = k;
+        liveSlots.pop_back();
+        freeSlots.push_back(slot);
+        generations[slot]++;
+    }
+
+    // Move every pellet down, the ones reaching the floor dissolve
+    void sink(float stepSeconds)
+    {
+        for (unsigned int k = static_cast<unsigned int>(liveSlots.size()); k > 0; k--)
+        {
+            unsigned int slot = liveSlots[k - 1];
+            prevY[slot] = y[slot];
+            y[slot] -= params.sinkSpeed * stepSeconds;
+            if (y[slot] < params.floorHeight)
+            {
+                stats.dissolved++;
+                release(slot);
+            }
+        }
+    }
+
+    // Pack the live pellets and rebuild the grid over them
+    void buildIndex()
+    {
+        for (unsigned int k = 0; k < size(); k++)
+        {
+            unsigned int slot = liveSlots[k];
+            indexX[k] = x[slot];
+            indexY[k] = y[slot];
+            indexZ[k] = z[slot];
+        }
+        grid.build(indexX.data(), indexY.data(), indexZ.data(), size(), params.fishSenseRadius);
+    }
+
+    // Each shark swims for its nearest pellet, or circles if the tank is empty
+    void feedSharks(SharkArchetype& sharks, float time, float stepSeconds)
+    {
+        for (unsigned int i = 0; i < sharks.size(); i++)
+        {
+            unsigned int nearest;
+            float distance2;
+            if (!grid.findNearest(sharks.x[i], sharks.y[i], sharks.z[i], indexX.data(), indexY.data(), indexZ.data(), nearest, distance2))
+            {
+                sharks.orbit(time, i);
+                continue;
+            }
+
+            glm::vec3 target(indexX[nearest], indexY[nearest], indexZ[nearest]);
+            if (sharks.chase(i, target, stepSeconds))
+            {
+                if (eatenBy[liveSlots[nearest]] == 0)
+                    eatenBy[liveSlots[nearest]] = EATEN_BY_SHARK;
+            }
+        }
+    }
+
+    // Mark the pellets claimed in the last fish pass as eaten
+    void applyFishBites()
+    {
+        for (unsigned int slot : liveSlots)
+        {
+            if (fishClaims[slot].load(std::memory_order_relaxed) == NO_CLAIM)
+                continue;
+            eatenBy[slot] = EATEN_BY_FISH;
+            fishClaims[slot].store(NO_CLAIM, std::memory_order_relaxed);
+        }
+    }
+
+    // Fish [begin, end) of a school turn towards a pellet they can sense, and eat it once in reach
+    void feedSchool(BoidSchool& school, float stepSeconds, unsigned int begin, unsigned int end)
+    {
+        const FishArchetype& fish = school.getFish();
+        const float senseRadius2 = params.fishSenseRadius * params.fishSenseRadius;
+        const float biteDistance2 = params.fishBiteDistance * params.fishBiteDistance;
+        for (unsigned int i = begin; i < end; i++)
+        {
+            glm::vec3 position(fish.x[i], fish.y[i], fish.z[i]);
+            unsigned int nearest = 0;
+            float nearestDistance2 = senseRadius2;
+            bool found = false;
+            grid.forEachNear(position.x, position.y, position.z, [&](unsigned int k)
+            {
+                glm::vec3 offset(indexX[k] - position.x, indexY[k] - position.y, indexZ[k] - position.z);
+                float distance2 = glm::dot(offset, offset);
+                if (distance2 < nearestDistance2 && eatenBy[liveSlots[k]] == 0)
+                {
+                    nearestDistance2 = distance2;
+                    nearest = k;
+                    found = true;
+                }
+                return true;
+            });
+            if (!found)
+                continue;
+
+            if (nearestDistance2 < biteDistance2)
+            {
+                // Claim the pellet, the lowest fish index keeps it whatever order the chunks run in
+                std::atomic<unsigned int>& claim = fishClaims[liveSlots[nearest]];
+                unsigned int claimedBy = claim.load(std::memory_order_relaxed);
+                while (i < claimedBy && !claim.compare_exchange_weak(claimedBy, i, std::memory_order_relaxed))
+                {
+                }
+                continue;
+            }
+            glm::vec3 toPellet = glm::vec3(indexX[nearest], indexY[nearest], indexZ[nearest]) - position;
+            school.accelerate(i, toPellet / std::sqrt(nearestDistance2) * params.fishAttraction, stepSeconds);
+        }
+    }
+};
+#endif // MY_FEEDING_H
@@ -0,0 +1,136 @@
+#ifndef MY_FRUSTUM_H
+#define MY_FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include <my_gl_counters.h>
+#include <my_mesh.h>
+#include <my_model.h>
+#include <my_shader.h>
+
+#include <cmath>
+
+// View frustum as six inward-facing planes (xyz normal, w distance)
+class Frustum
+{
+public:
+    glm::vec4 planes[6];
+
+    // Extract the planes from a view-projection matrix (Gribb/Hartmann)
+    void update(const glm::mat4& viewProjection)
+    {
+        const glm::mat4& m = viewProjection;
+        for (int i = 0; i < 3; i++)
+        {
+            planes[i * 2] = glm::vec4(m[0][3] + m[0][i], m[1][3] + m[1][i], m[2][3] + m[2][i], m[3][3] + m[3][i]);
+            planes[i * 2 + 1] = glm::vec4(m[0][3] - m[0][i], m[1][3] - m[1][i], m[2][3] - m[2][i], m[3][3] - m[3][i]);
+        }
+
+        // Normalize so sphere tests get real distances
+        for (glm::vec4& plane : planes)
+            plane *= 1.0f / glm::length(glm::vec3(plane));
+    }
+
+    // Check if a world-space sphere is at least partly inside
+    bool containsSphere(const glm::vec3& center, float radius) const
+    {
+        for (const glm::vec4& plane : planes)
+        {
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+                return false;
+        }
+        return true;
+    }
+
+    // Check if a world-space AABB (centre and half extents) is at least partly inside
+    bool containsBox(const glm::vec3& center, const glm::vec3& extents) const
+    {
+        for (const glm::vec4& plane : planes)
+        {
+            float radius = glm::dot(extents, glm::abs(glm::vec3(plane)));
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+                return false;
+        }
+        return true;
+    }
+};
+
+// Tests world-space bounds against the camera frustum before drawing, counting what it rejects
+class FrustumCuller
+{
+public:
+    // Start a new frame
+    void update(const glm::mat4& viewProjection)
+    {
+        frustum.update(viewProjection);
+        stats = CullingStats();
+    }
+
+    // Model-level early out: sphere around the root origin containing all meshes
+    bool isModelVisible(const Model& model, const glm::mat4& rootMatrix)
+    {
+        stats.modelsTested++;
+        glm::vec3 center = glm::vec3(rootMatrix[3]);
+        if (frustum.containsSphere(center, model.getBoundingRadius() * getMaxScale(rootMatrix)))
+            return true;
+
+        // None of its meshes get drawn
+        stats.modelsCulled++;
+        stats.meshesCulled += static_cast<unsigned int>(model.meshes.size());
+        return false;
+    }
+
+    // Mesh-level test: bounding sphere first, then the transformed AABB
+    bool isMeshVisible(const MeshData& mesh, const glm::mat4& worldMatrix)
+    {
+        stats.meshesTested++;
+
+        glm::vec3 sphereCenter = glm::vec3(worldMatrix * glm::vec4(mesh.sphereCenter, 1.0f));
+        bool visible = frustum.containsSphere(sphereCenter, mesh.sphereRadius * getMaxScale(worldMatrix));
+        if (visible)
+        {
+            // Half extents of the box around the transformed AABB
+            glm::vec3 localCenter = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+            glm::vec3 localExtents = (mesh.boundsMax - mesh.boundsMin) * 0.5f;
+            glm::vec3 center = glm::vec3(worldMatrix * glm::vec4(localCenter, 1.0f));
+            glm::vec3 extents = glm::abs(glm::vec3(worldMatrix[0])) * localExtents.x
+                + glm::abs(glm::vec3(worldMatrix[1])) * localExtents.y
+                + glm::abs(glm::vec3(worldMatrix[2])) * localExtents.z;
+            visible = frustum.containsBox(center, extents);
+        }
+
+        if (!visible)
+            stats.meshesCulled++;
+        return visible;
+    }
+
+    // Draw the visible meshes of a model that uses one matrix for all its meshes
+    void drawModel(Model& model, Shader& shader, const glm::mat4& modelMatrix)
+    {
+        if (model.meshes.size() > 1 && !isModelVisible(model, modelMatrix))
+            return;
+
+        for (Mesh& mesh : model.meshes)
+        {
+            if (isMeshVisible(*mesh.data, modelMatrix))
+                mesh.draw(shader);
+        }
+    }
+
+    const CullingStats& getStats() const
+    {
+        return stats;
+    }
+
+private:
+    Frustum frustum;
+    CullingStats stats;
+
+    // Largest axis scale of a matrix (radii grow by this much)
+    static float getMaxScale(const glm::mat4& matrix)
+    {
+        return std::sqrt(glm::max(glm::max(glm::dot(glm::vec3(matrix[0]), glm::vec3(matrix[0])),
+            glm::dot(glm::vec3(matrix[1]), glm::vec3(matrix[1]))), glm::dot(glm::vec3(matrix[2]), glm::vec3(matrix[2]))));
+    }
+};
+#endif // MY_FRUSTUM_H
@@ -0,0 +1,161 @@
+#ifndef MY_GL_COUNTERS_H
+#define MY_GL_COUNTERS_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// GL work submitted in one frame
+struct FrameGLCounters
+{
+    uint64_t drawCalls = 0;
+    uint64_t indices = 0;           // Indices (or vertices) of the draws, once per instance
+    uint64_t triangles = 0;         // Triangles of the draws (instances included), points and lines not counted
+    uint64_t textureBinds = 0;
+    uint64_t programSwitches = 0;   // glUseProgram calls
+    uint64_t vaoBinds = 0;          // glBindVertexArray calls, unbinds included
+    uint64_t uniformUploads = 0;    // glUniform* calls and uniform block updates
+};
+
+// Culling counters for the current frame (filled in by FrustumCuller), shown and logged with the GL counters
+struct CullingStats
+{
+    unsigned int modelsTested = 0;
+    unsigned int modelsCulled = 0;  // Whole models rejected before looking at their meshes
+    unsigned int meshesTested = 0;
+    unsigned int meshesCulled = 0;  // Draws skipped
+};
+
+// Thin wrappers around the GL calls the renderer makes per frame (draws, binds, program and uniform changes),
+// counting each frame's calls so they can be shown and logged (render thread only)
+class GLCounters
+{
+public:
+    // Start counting a new frame
+    static void beginFrame()
+    {
+        getCurrent() = FrameGLCounters();
+    }
+
+    // Counts since beginFrame()
+    static const FrameGLCounters& getFrame()
+    {
+        return getCurrent();
+    }
+
+    static void drawArrays(GLenum mode, GLint first, GLsizei count)
+    {
+        countDraw(mode, count, 1);
+        glDrawArrays(mode, first, count);
+    }
+
+    static void drawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount)
+    {
+        countDraw(mode, count, instanceCount);
+        glDrawArraysInstanced(mode, first, count, instanceCount);
+    }
+
+    static void drawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+    {
+        countDraw(mode, count, 1);
+        glDrawElements(mode, count, type, indices);
+    }
+
+    static void drawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instanceCount)
+    {
+        countDraw(mode, count, instanceCount);
+        glDrawElementsInstanced(mode, count, type, indices, instanceCount);
+    }
+
+    static void bindTexture(GLenum target, GLuint texture)
+    {
+        getCurrent().textureBinds++;
+        glBindTexture(target, texture);
+    }
+
+    static void useProgram(GLuint program)
+    {
+        getCurrent().programSwitches++;
+        glUseProgram(program);
+    }
+
+    static void bindVertexArray(GLuint array)
+    {
+        getCurrent().vaoBinds++;
+        glBindVertexArray(array);
+    }
+
+    // Any glUniform* call, e.g. GLCounters::uniform(glUniform1f, location, value)
+    template <typename F, typename... Args>
+    static void uniform(F upload, Args... args)
+    {
+        getCurrent().uniformUploads++;
+        upload(args...);
+    }
+
+    // Update of a uniform block's buffer (bound to GL_UNIFORM_BUFFER)
+    static void uniformBlockData(GLintptr offset, GLsizeiptr size, const void* data)
+    {
+        getCurrent().uniformUploads++;
+        glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+    }
+
+private:
+    static FrameGLCounters& getCurrent()
+    {
+        static FrameGLCounters current;
+        return current;
+    }
+
+    static void countDraw(GLenum mode, GLsizei count, GLsizei instanceCount)
+    {
+        FrameGLCounters& current = getCurrent();
+        current.drawCalls++;
+        current.indices += uint64_t(count) * instanceCount;
+        uint64_t trianglesPerInstance = 0;
+        if (mode == GL_TRIANGLES)
+            trianglesPerInstance = count / 3;
+        else if ((mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN) && count > 2)
+            trianglesPerInstance = count - 2;
+        current.triangles += trianglesPerInstance * instanceCount;
+    }
+};
+
+// Per-frame counters written as CSV, one row per frame (--gl-log)
+class GLCounterLog
+{
+public:
+    // Start a log, returns false if the file can't be written
+    bool open(const std::string& path)
+    {
+        out.open(path, std::ios::trunc);
+        if (!out)
+        {
+            std::cout << "ERROR::GL_COUNTERS::COULD_NOT_WRITE " << path << std::endl;
+            return false;
+        }
+        out << "frame,draw_calls,indices,triangles,texture_binds,program_switches,vao_binds,uniform_uploads,models_culled,meshes_culled\n";
+        return true;
+    }
+
+    bool isOpen() const
+    {
+        return out.is_open();
+    }
+
+    // Add the next frame's row
+    void write(const FrameGLCounters& counters, const CullingStats& culling)
+    {
+        out << frame++ << ',' << counters.drawCalls << ',' << counters.indices << ',' << counters.triangles << ','
+            << counters.textureBinds << ',' << counters.programSwitches << ',' << counters.vaoBinds << ',' << counters.uniformUploads << ','
+            << culling.modelsCulled << ',' << culling.meshesCulled << '\n';
+    }
+
+private:
+    std::ofstream out;
+    unsigned int frame = 0;
+};
+#endif // MY_GL_COUNTERS_H
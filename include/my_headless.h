@@ -0,0 +1,280 @@
+#ifndef MY_HEADLESS_H
+#define MY_HEADLESS_H
+
+#include <glad/glad.h>
+
+#include <my_gl_counters.h>
+#include <my_timing.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+// Offscreen contexts need EGL, build with MY_HEADLESS_EGL defined (and link libEGL) to enable --headless
+#ifdef MY_HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+#endif
+
+// OpenGL 3.3 core context with no window, surface or display server: EGL on Mesa's surfaceless platform
+// (llvmpipe when there is no GPU), or the default EGL display where that isn't available.
+// Rendering goes to an OffscreenTarget.
+class HeadlessContext
+{
+public:
+    // Create the context and make it current, returns false (after printing why) if it can't
+    bool create()
+    {
+#ifdef MY_HEADLESS_EGL
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay)
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if (display == EGL_NO_DISPLAY)
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+        EGLint major = 0, minor = 0;
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+        {
+            std::cout << "ERROR::HEADLESS::NO_EGL_DISPLAY" << std::endl;
+            return false;
+        }
+
+        // Any surface type (the default asks for window surfaces, which a surfaceless display doesn't have)
+        const EGLint configAttributes[] = { EGL_SURFACE_TYPE, 0, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+        EGLConfig config;
+        EGLint numConfigs = 0;
+        if (!eglChooseConfig(display, configAttributes, &config, 1, &numConfigs) || numConfigs == 0 || !eglBindAPI(EGL_OPENGL_API))
+        {
+            std::cout << "ERROR::HEADLESS::NO_OPENGL_CONFIG" << std::endl;
+            return false;
+        }
+
+        const EGLint contextAttributes[] =
+        {
+            EGL_CONTEXT_MAJOR_VERSION, 3,
+            EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+        if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+        {
+            std::cout << "ERROR::HEADLESS::CONTEXT_CREATION_FAILED: 0x" << std::hex << eglGetError() << std::dec << std::endl;
+            return false;
+        }
+        std::cout << "Headless EGL " << major << "." << minor << " context" << std::endl;
+        return true;
+#else
+        std::cout << "ERROR::HEADLESS::NOT_BUILT_WITH_EGL (define MY_HEADLESS_EGL and link libEGL)" << std::endl;
+        return false;
+#endif
+    }
+
+    // Destroy the context
+    ~HeadlessContext()
+    {
+#ifdef MY_HEADLESS_EGL
+        if (display != EGL_NO_DISPLAY)
+        {
+            eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            if (context != EGL_NO_CONTEXT)
+                eglDestroyContext(display, context);
+            eglTerminate(display);
+        }
+#endif
+    }
+
+    // Function loader for glad
+    static GLADloadproc getLoader()
+    {
+#ifdef MY_HEADLESS_EGL
+        return (GLADloadproc)eglGetProcAddress;
+#else
+        return nullptr;
+#endif
+    }
+
+private:
+#ifdef MY_HEADLESS_EGL
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+#endif
+};
+
+// Framebuffer object with a colour and a depth renderbuffer, drawn into instead of a window
+class OffscreenTarget
+{
+public:
+    // Constructor (needs a current context)
+    OffscreenTarget(unsigned int width, unsigned int height)
+        : width(width), height(height)
+    {
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+
+        glGenRenderbuffers(1, &colorRBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorRBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRBO);
+
+        glGenRenderbuffers(1, &depthRBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthRBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRBO);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER::OFFSCREEN_TARGET_INCOMPLETE" << std::endl;
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    ~OffscreenTarget()
+    {
+        glDeleteFramebuffers(1, &FBO);
+        glDeleteRenderbuffers(1, &colorRBO);
+        glDeleteRenderbuffers(1, &depthRBO);
+    }
+
+    OffscreenTarget(const OffscreenTarget&) = delete;
+    OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+
+    // Draw into the target from now on
+    void bind()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glViewport(0, 0, width, height);
+    }
+
+    // Write the colour buffer to a binary PPM (for checking what was rendered)
+    bool savePPM(const char* path)
+    {
+        std::vector<unsigned char> pixels(width * height * 4);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+        FILE* file = std::fopen(path, "wb");
+        if (!file)
+        {
+            std::cout << "ERROR::FRAMEBUFFER::COULD_NOT_WRITE " << path << std::endl;
+            return false;
+        }
+        std::fprintf(file, "P6\n%u %u\n255\n", width, height);
+        for (unsigned int row = height; row > 0; row--)    // GL rows start at the bottom
+        {
+            for (unsigned int column = 0; column < width; column++)
+                std::fwrite(&pixels[((row - 1) * width + column) * 4], 1, 3, file);
+        }
+        std::fclose(file);
+        return true;
+    }
+
+private:
+    unsigned int width, height;
+    unsigned int FBO = 0;
+    unsigned int colorRBO = 0;
+    unsigned int depthRBO = 0;
+};
+
+// Collects frame times and GL work per frame, prints their distribution or writes it as JSON
+class FrameTimeStats
+{
+public:
+    // Record one frame (milliseconds), the GL work it submitted and what culling left out
+    void add(double frameMs, const FrameGLCounters& counters = FrameGLCounters(), const CullingStats& culling = CullingStats())
+    {
+        frameTimes.push_back(frameMs);
+        totalDrawCalls += counters.drawCalls;
+        totalTriangles += counters.triangles;
+        totalModelsCulled += culling.modelsCulled;
+        totalMeshesCulled += culling.meshesCulled;
+        maxDrawCalls = std::max(maxDrawCalls, counters.drawCalls);
+        maxTriangles = std::max(maxTriangles, counters.triangles);
+    }
+
+    unsigned int size() const
+    {
+        return static_cast<unsigned int>(frameTimes.size());
+    }
+
+    // Frame time at a percentile (0 to 100)
+    double getPercentile(double percentile) const
+    {
+        std::vector<double> sorted = frameTimes;
+        std::sort(sorted.begin(), sorted.end());
+        return getSortedPercentile(sorted, percentile);
+    }
+
+    double getMean() const
+    {
+        if (frameTimes.empty())
+            return 0.0;
+        return std::accumulate(frameTimes.begin(), frameTimes.end(), 0.0) / frameTimes.size();
+    }
+
+    // Print min, mean, median, p95, p99 and max
+    void print(std::ostream& out) const
+    {
+        std::streamsize precision = out.precision();
+        out << std::fixed << std::setprecision(3)
+            << "Frame times over " << size() << " frames (ms): min " << getPercentile(0.0)
+            << "  mean " << getMean() << "  median " << getPercentile(50.0) << "  p95 " << getPercentile(95.0)
+            << "  p99 " << getPercentile(99.0) << "  max " << getPercentile(100.0);
+        if (getMean() > 0.0)
+            out << "  (" << std::setprecision(1) << 1000.0 / getMean() << " fps)";
+        out << std::defaultfloat << std::setprecision(precision) << std::endl;
+        if (!frameTimes.empty())
+            out << "Per frame: " << totalDrawCalls / size() << " draw calls, " << totalTriangles / size() << " triangles, "
+                << totalMeshesCulled / size() << " meshes culled (" << totalModelsCulled / size() << " whole models)" << std::endl;
+    }
+
+    // Write the distribution as one flat JSON object (read by perf_regression), returns false if the file can't be written
+    bool writeJson(const std::string& path, const std::string& renderer, unsigned int width, unsigned int height) const
+    {
+        std::ofstream out(path);
+        if (!out)
+        {
+            std::cout << "ERROR::STATS::COULD_NOT_WRITE " << path << std::endl;
+            return false;
+        }
+        double frames = std::max(1u, size());
+        out << std::fixed << std::setprecision(4) << "{\n"
+            << "  \"renderer\": \"" << renderer << "\",\n"
+            << "  \"width\": " << width << ",\n"
+            << "  \"height\": " << height << ",\n"
+            << "  \"frames\": " << size() << ",\n"
+            << "  \"frame_ms_min\": " << getPercentile(0.0) << ",\n"
+            << "  \"frame_ms_mean\": " << getMean() << ",\n"
+            << "  \"frame_ms_p50\": " << getPercentile(50.0) << ",\n"
+            << "  \"frame_ms_p95\": " << getPercentile(95.0) << ",\n"
+            << "  \"frame_ms_p99\": " << getPercentile(99.0) << ",\n"
+            << "  \"frame_ms_max\": " << getPercentile(100.0) << ",\n"
+            << "  \"draw_calls_mean\": " << totalDrawCalls / frames << ",\n"
+            << "  \"draw_calls_max\": " << maxDrawCalls << ",\n"
+            << "  \"triangles_mean\": " << totalTriangles / frames << ",\n"
+            << "  \"triangles_max\": " << maxTriangles << ",\n"
+            << "  \"models_culled_mean\": " << totalModelsCulled / frames << ",\n"
+            << "  \"meshes_culled_mean\": " << totalMeshesCulled / frames << "\n"
+            << "}\n";
+        return true;
+    }
+
+private:
+    std::vector<double> frameTimes;
+    uint64_t totalDrawCalls = 0;
+    uint64_t totalTriangles = 0;
+    uint64_t maxDrawCalls = 0;
+    uint64_t maxTriangles = 0;
+    uint64_t totalModelsCulled = 0;
+    uint64_t totalMeshesCulled = 0;
+};
+#endif // MY_HEADLESS_H
@@ -0,0 +1,159 @@
+#ifndef MY_HUD_H
+#define MY_HUD_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <my_gl_counters.h>
+#include <my_shader.h>
+
+#include <cctype>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// 3x5 pixel font: upper case letters, digits and a little punctuation (anything else draws as a space).
+// Each glyph is five rows of three bits, top row first, leftmost pixel in the high bit of its row.
+const char HUD_FONT_CHARACTERS[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ.:-/%()";
+const unsigned short HUD_FONT_GLYPHS[] =
+{
+    0b111'101'101'101'111, 0b010'110'010'010'111, 0b111'001'111'100'111, 0b111'001'111'001'111, 0b101'101'111'001'001,
+    0b111'100'111'001'111, 0b111'100'111'101'111, 0b111'001'001'001'001, 0b111'101'111'101'111, 0b111'101'111'001'111,
+    0b010'101'111'101'101, 0b110'101'110'101'110, 0b011'100'100'100'011, 0b110'101'101'101'110, 0b111'100'110'100'111,
+    0b111'100'110'100'100, 0b011'100'101'101'011, 0b101'101'111'101'101, 0b111'010'010'010'111, 0b001'001'001'101'010,
+    0b101'101'110'101'101, 0b100'100'100'100'111, 0b101'111'111'101'101, 0b110'101'101'101'101, 0b010'101'101'101'010,
+    0b110'101'110'100'100, 0b010'101'101'110'011, 0b110'101'110'101'101, 0b011'100'010'001'110, 0b111'010'010'010'010,
+    0b101'101'101'101'111, 0b101'101'101'101'010, 0b101'101'111'111'101, 0b101'101'010'101'101, 0b101'101'010'010'010,
+    0b111'001'010'100'111, 0b000'000'000'000'010, 0b000'010'000'010'000, 0b000'000'111'000'000, 0b001'001'010'100'100,
+    0b101'001'010'100'101, 0b010'100'100'100'010, 0b010'001'001'001'010,
+};
+static_assert(sizeof(HUD_FONT_GLYPHS) / sizeof(HUD_FONT_GLYPHS[0]) == sizeof(HUD_FONT_CHARACTERS) - 1, "One glyph per character");
+
+// Screen-space overlay of flat rectangles and text, in pixels from the top left of the screen.
+// Everything added since clear() goes out in one draw, on top of the scene.
+class HudOverlay
+{
+public:
+    // Constructor (needs a current context)
+    HudOverlay()
+        : shader("shaders/hud.vs", "shaders/hud.fs")
+    {
+        screenSizeUniform = shader.uniform<glm::vec2>("screenSize");
+
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (void*)offsetof(HudVertex, color));
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    ~HudOverlay()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+    }
+
+    HudOverlay(const HudOverlay&) = delete;
+    HudOverlay& operator=(const HudOverlay&) = delete;
+
+    // Start a new overlay
+    void clear()
+    {
+        vertices.clear();
+    }
+
+    // Filled rectangle
+    void addRect(float x, float y, float width, float height, const glm::vec4& color)
+    {
+        const glm::vec2 corners[6] =
+        {
+            glm::vec2(x, y), glm::vec2(x, y + height), glm::vec2(x + width, y + height),
+            glm::vec2(x, y), glm::vec2(x + width, y + height), glm::vec2(x + width, y),
+        };
+        for (const glm::vec2& corner : corners)
+            vertices.push_back({ corner, color });
+    }
+
+    // Line of text with glyph pixels scale screen pixels across, returns its width in pixels
+    float addText(float x, float y, const std::string& text, const glm::vec4& color, float scale = 2.0f)
+    {
+        float penX = x;
+        for (char c : text)
+        {
+            const char* found = std::strchr(HUD_FONT_CHARACTERS, std::toupper(static_cast<unsigned char>(c)));
+            if (c != '\0' && found)
+            {
+                unsigned short glyph = HUD_FONT_GLYPHS[found - HUD_FONT_CHARACTERS];
+                for (int row = 0; row < 5; row++)
+                {
+                    for (int column = 0; column < 3; column++)
+                    {
+                        if (glyph & (1 << ((4 - row) * 3 + (2 - column))))
+                            addRect(penX + column * scale, y + row * scale, scale, scale, color);
+                    }
+                }
+            }
+            penX += getCharacterAdvance(scale);
+        }
+        return penX - x;
+    }
+
+    // Horizontal distance from one character to the next
+    static float getCharacterAdvance(float scale = 2.0f)
+    {
+        return 4.0f * scale;
+    }
+
+    // Vertical distance from one line to the next
+    static float getLineHeight(float scale = 2.0f)
+    {
+        return 7.0f * scale;
+    }
+
+    // Draw everything added since clear() over what is on screen
+    void draw(unsigned int screenWidth, unsigned int screenHeight)
+    {
+        if (vertices.empty())
+            return;
+
+        shader.use();
+        screenSizeUniform.set(glm::vec2(float(screenWidth), float(screenHeight)));
+
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+        glDisable(GL_DEPTH_TEST);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+        // Orphan the old contents, the overlay changes every frame
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(HudVertex), vertices.data(), GL_STREAM_DRAW);
+        GLCounters::bindVertexArray(VAO);
+        GLCounters::drawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(vertices.size()));
+        GLCounters::bindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        if (depthTest)
+            glEnable(GL_DEPTH_TEST);
+    }
+
+private:
+    struct HudVertex
+    {
+        glm::vec2 position;
+        glm::vec4 color;
+    };
+
+    Shader shader;
+    Uniform<glm::vec2> screenSizeUniform;
+    unsigned int VAO = 0;
+    unsigned int VBO = 0;
+    std::vector<HudVertex> vertices;
+};
+#endif // MY_HUD_H
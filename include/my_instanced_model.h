@@ -0,0 +1,101 @@
+#ifndef MY_INSTANCED_MODEL_H
+#define MY_INSTANCED_MODEL_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <my_mesh.h>
+#include <my_model.h>
+#include <my_shader.h>
+
+#include <vector>
+
+// Draws many copies of one model with a single instanced draw call per mesh.
+// Per-instance model matrices are collected each frame and streamed into one
+// instance buffer per mesh, which is attached to the (shared) mesh VAO.
+class InstancedModel
+{
+public:
+    // Constructor (expects the prototype model all instances are copied from)
+    InstancedModel(Model& prototype, unsigned int initialCapacity = 64)
+        : prototype(&prototype)
+    {
+        unsigned int numMeshes = static_cast<unsigned int>(prototype.meshes.size());
+        instanceMatrices.resize(numMeshes);
+        instanceVBOs.resize(numMeshes);
+        capacities.resize(numMeshes, initialCapacity);
+
+        glGenBuffers(numMeshes, instanceVBOs.data());
+        for (unsigned int i = 0; i < numMeshes; i++)
+        {
+            instanceMatrices[i].reserve(initialCapacity);
+
+            // Allocate storage up front, contents are streamed in every frame
+            glBindBuffer(GL_ARRAY_BUFFER, instanceVBOs[i]);
+            glBufferData(GL_ARRAY_BUFFER, initialCapacity * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+            prototype.meshes[i].setupInstanceBuffer(instanceVBOs[i]);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // Remove all instances (call at the start of each frame)
+    void clear()
+    {
+        for (std::vector<glm::mat4>& matrices : instanceMatrices)
+            matrices.clear();
+    }
+
+    // Add an instance where every mesh uses the same model matrix
+    void addInstance(const glm::mat4& instanceMatrix)
+    {
+        for (std::vector<glm::mat4>& matrices : instanceMatrices)
+            matrices.push_back(instanceMatrix);
+    }
+
+    // Add an instance of a single mesh (for models animated per mesh)
+    void addInstance(unsigned int meshIndex, const glm::mat4& instanceMatrix)
+    {
+        instanceMatrices[meshIndex].push_back(instanceMatrix);
+    }
+
+    // Upload this frame's instance matrices and draw each mesh once
+    void draw(Shader& shader)
+    {
+        // Resolve the uniform handle once per program
+        if (shader.ID != shaderID)
+        {
+            useInstancingUniform = shader.uniform<bool>("useInstancing");
+            shaderID = shader.ID;
+        }
+
+        useInstancingUniform.set(true);
+        for (unsigned int i = 0; i < static_cast<unsigned int>(instanceMatrices.size()); i++)
+        {
+            unsigned int count = static_cast<unsigned int>(instanceMatrices[i].size());
+            if (count == 0)
+                continue;
+
+            glBindBuffer(GL_ARRAY_BUFFER, instanceVBOs[i]);
+
+            // Grow the buffer if needed, otherwise orphan it so we don't stall on last frame's draw
+            if (count > capacities[i])
+                capacities[i] = count * 2;
+            glBufferData(GL_ARRAY_BUFFER, capacities[i] * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(glm::mat4), instanceMatrices[i].data());
+
+            prototype->meshes[i].drawInstanced(shader, count);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        useInstancingUniform.set(false);
+    }
+
+private:
+    Model* prototype;
+    unsigned int shaderID = 0;
+    Uniform<bool> useInstancingUniform;
+    std::vector<std::vector<glm::mat4>> instanceMatrices;
+    std::vector<unsigned int> instanceVBOs;
+    std::vector<unsigned int> capacities;
+};
+#endif // MY_INSTANCED_MODEL_H
@@ -0,0 +1,181 @@
+#ifndef MY_JOB_SYSTEM_H
+#define MY_JOB_SYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Work-stealing scheduler for data-parallel loops. Every thread has its own queue: it takes work from the
+// back of its own queue and, when that is empty, steals from the front of the others. The thread calling
+// parallelFor works on the loop too, so a JobSystem of N threads starts N - 1 workers.
+// parallelFor is meant to be called from one thread at a time (the main loop), not from inside jobs.
+class JobSystem
+{
+public:
+    // Start the workers (numThreads counts the calling thread, defaults to one per core)
+    JobSystem(unsigned int numThreads = defaultThreadCount())
+    {
+        numThreads = std::max(1u, numThreads);
+        for (unsigned int i = 0; i < numThreads; i++)
+            queues.push_back(std::make_unique<WorkQueue>());
+        for (unsigned int i = 1; i < numThreads; i++)
+            workers.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    // Stop and join the workers (no loop can be running)
+    ~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wakeCondition.notify_all();
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Call body(begin, end) over [0, count) in chunks of grainSize, returns when every chunk is done
+    template <typename F>
+    void parallelFor(unsigned int count, unsigned int grainSize, F&& body)
+    {
+        if (count == 0)
+            return;
+
+        grainSize = std::max(1u, grainSize);
+        unsigned int numChunks = (count + grainSize - 1) / grainSize;
+        if (numChunks == 1 || workers.empty())
+        {
+            body(0u, count);
+            return;
+        }
+
+        // Deal the chunks out round-robin, stealing evens out whatever imbalance is left
+        typedef typename std::remove_reference<F>::type Body;
+        std::atomic<unsigned int> remaining(numChunks);
+        for (unsigned int c = 0; c < numChunks; c++)
+        {
+            Job job;
+            job.invoke = [](void* context, unsigned int begin, unsigned int end) { (*static_cast<Body*>(context))(begin, end); };
+            job.context = const_cast<void*>(static_cast<const void*>(&body));
+            job.begin = c * grainSize;
+            job.end = std::min(count, job.begin + grainSize);
+            job.remaining = &remaining;
+
+            WorkQueue& queue = *queues[c % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.jobs.push_back(job);
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            pendingJobs.fetch_add(static_cast<int>(numChunks));
+        }
+        wakeCondition.notify_all();
+
+        // Help out until the last chunk finishes
+        while (remaining.load(std::memory_order_acquire) > 0)
+        {
+            if (!runJob(0))
+                std::this_thread::yield();
+        }
+    }
+
+    // Threads working on a loop, including the caller
+    unsigned int size() const
+    {
+        return static_cast<unsigned int>(queues.size());
+    }
+
+    static unsigned int defaultThreadCount()
+    {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+private:
+    // One chunk of a loop
+    struct Job
+    {
+        void (*invoke)(void* context, unsigned int begin, unsigned int end);
+        void* context;
+        unsigned int begin;
+        unsigned int end;
+        std::atomic<unsigned int>* remaining;
+    };
+
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;     // Index 0 belongs to the calling thread
+    std::vector<std::thread> workers;
+    std::atomic<int> pendingJobs{ 0 };                   // Queued and not yet taken
+    std::mutex sleepMutex;
+    std::condition_variable wakeCondition;
+    bool stopping = false;
+
+    // Take a job from the back of the own queue, or steal from the front of another
+    bool takeJob(unsigned int index, Job& job)
+    {
+        {
+            WorkQueue& own = *queues[index];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.jobs.empty())
+            {
+                job = own.jobs.back();
+                own.jobs.pop_back();
+                return true;
+            }
+        }
+        for (unsigned int i = 1; i < static_cast<unsigned int>(queues.size()); i++)
+        {
+            WorkQueue& victim = *queues[(index + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.jobs.empty())
+            {
+                job = victim.jobs.front();
+                victim.jobs.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Run one job if there is any, returns false if every queue was empty
+    bool runJob(unsigned int index)
+    {
+        Job job;
+        if (!takeJob(index, job))
+            return false;
+
+        pendingJobs.fetch_sub(1);
+        job.invoke(job.context, job.begin, job.end);
+        job.remaining->fetch_sub(1, std::memory_order_release);
+        return true;
+    }
+
+    // Run jobs, sleeping while there are none, until stopped
+    void workerLoop(unsigned int index)
+    {
+        for (;;)
+        {
+            if (runJob(index))
+                continue;
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wakeCondition.wait(lock, [this] { return stopping || pendingJobs.load() > 0; });
+            if (stopping)
+                return;
+        }
+    }
+};
+#endif // MY_JOB_SYSTEM_H
@@ -0,0 +1,104 @@
+#ifndef MY_KELP_BATCH_H
+#define MY_KELP_BATCH_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <my_frustum.h>
+#include <my_instanced_model.h>
+#include <my_mesh.h>
+#include <my_model.h>
+#include <my_shader.h>
+
+#include <vector>
+
+// Kelp stalks bent in the vertex shader. The segment meshes are merged into one mesh with a
+// per-vertex segment index (attribute location 8), so all stalks are one instanced draw.
+class KelpBatch
+{
+public:
+    // Constructor (expects the segmented kelp prototype with its CPU geometry still loaded)
+    KelpBatch(const Model& segmentedKelp)
+        : kelpModel(mergeSegments(segmentedKelp))
+        , batch(kelpModel)
+    {
+        // Segment index of every merged vertex
+        std::vector<float> segments;
+        for (unsigned int j = 0; j < static_cast<unsigned int>(segmentedKelp.meshes.size()); j++)
+            segments.insert(segments.end(), segmentedKelp.meshes[j].data->vertices.size(), static_cast<float>(j));
+
+        glGenBuffers(1, &segmentVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, segmentVBO);
+        glBufferData(GL_ARRAY_BUFFER, segments.size() * sizeof(float), segments.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        if (!kelpModel.meshes.empty())
+            kelpModel.meshes[0].setupAttribute(segmentVBO, 8, 1, sizeof(float), 0, 0);
+
+        // Bounds are computed, the merged CPU copy isn't needed
+        kelpModel.releaseGeometry();
+    }
+
+    // Not copyable, the batch points at the merged model
+    KelpBatch(const KelpBatch&) = delete;
+    KelpBatch& operator=(const KelpBatch&) = delete;
+
+    // Add a stalk by its root matrix (translation and yaw, no sway)
+    void addStalk(const glm::mat4& rootMatrix)
+    {
+        rootMatrices.push_back(rootMatrix);
+    }
+
+    // Draw the stalks that are on screen with one call
+    void draw(Shader& shader, FrustumCuller& culler)
+    {
+        // Resolve the uniform handle once per program
+        if (shader.ID != shaderID)
+        {
+            useKelpSwayUniform = shader.uniform<bool>("useKelpSway");
+            shaderID = shader.ID;
+        }
+
+        // Sway only rotates about the root, so the sphere around it bounds the whole stalk
+        batch.clear();
+        for (const glm::mat4& rootMatrix : rootMatrices)
+        {
+            if (culler.isModelVisible(kelpModel, rootMatrix))
+                batch.addInstance(rootMatrix);
+        }
+
+        useKelpSwayUniform.set(true);
+        batch.draw(shader);
+        useKelpSwayUniform.set(false);
+    }
+
+private:
+    Model kelpModel;
+    InstancedModel batch;
+    std::vector<glm::mat4> rootMatrices;
+    unsigned int segmentVBO;
+    unsigned int shaderID = 0;
+    Uniform<bool> useKelpSwayUniform;
+
+    // Concatenate the segment meshes into one (they all share the kelp material)
+    static Model mergeSegments(const Model& segmentedKelp)
+    {
+        std::vector<MeshGeometry> geometry(1);
+        MeshGeometry& merged = geometry[0];
+        for (const Mesh& segment : segmentedKelp.meshes)
+        {
+            unsigned int baseVertex = static_cast<unsigned int>(merged.vertices.size());
+            merged.vertices.insert(merged.vertices.end(), segment.data->vertices.begin(), segment.data->vertices.end());
+            for (unsigned int index : segment.data->indices)
+                merged.indices.push_back(baseVertex + index);
+        }
+        if (!segmentedKelp.meshes.empty())
+        {
+            for (const Texture& texture : segmentedKelp.meshes[0].data->textures)
+                merged.texturePaths.push_back(texture.path);
+        }
+        return Model(geometry);
+    }
+};
+#endif // MY_KELP_BATCH_H
@@ -0,0 +1,109 @@
+#ifndef MY_MAPPED_FILE_H
+#define MY_MAPPED_FILE_H
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    // Map the file (check isOpen() afterwards)
+    MappedFile(const std::string& path)
+    {
+#ifdef _WIN32
+        fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (fileHandle == INVALID_HANDLE_VALUE)
+            return;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+            return;
+
+        mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mappingHandle == NULL)
+            return;
+
+        mappedData = static_cast<const unsigned char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+        if (mappedData != nullptr)
+            mappedSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+        fileDescriptor = open(path.c_str(), O_RDONLY);
+        if (fileDescriptor < 0)
+            return;
+
+        struct stat fileStat;
+        if (fstat(fileDescriptor, &fileStat) != 0 || fileStat.st_size == 0)
+            return;
+
+        void* mapping = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+        if (mapping == MAP_FAILED)
+            return;
+
+        mappedData = static_cast<const unsigned char*>(mapping);
+        mappedSize = static_cast<size_t>(fileStat.st_size);
+#endif
+    }
+
+    // Unmap and close
+    ~MappedFile()
+    {
+#ifdef _WIN32
+        if (mappedData != nullptr)
+            UnmapViewOfFile(mappedData);
+        if (mappingHandle != NULL)
+            CloseHandle(mappingHandle);
+        if (fileHandle != INVALID_HANDLE_VALUE)
+            CloseHandle(fileHandle);
+#else
+        if (mappedData != nullptr)
+            munmap(const_cast<unsigned char*>(mappedData), mappedSize);
+        if (fileDescriptor >= 0)
+            close(fileDescriptor);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Check if the file was mapped
+    bool isOpen() const
+    {
+        return mappedData != nullptr;
+    }
+
+    // Start of the mapped bytes
+    const unsigned char* data() const
+    {
+        return mappedData;
+    }
+
+    // Number of mapped bytes
+    size_t size() const
+    {
+        return mappedSize;
+    }
+
+private:
+    const unsigned char* mappedData = nullptr;
+    size_t mappedSize = 0;
+#ifdef _WIN32
+    HANDLE fileHandle = INVALID_HANDLE_VALUE;
+    HANDLE mappingHandle = NULL;
+#else
+    int fileDescriptor = -1;
+#endif
+};
+#endif // MY_MAPPED_FILE_H
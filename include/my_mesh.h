@@ -6,8 +6,12 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <my_gl_counters.h>
+#include <my_pose_kernel.h>
 #include <my_shader.h>
+#include <my_texture_registry.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -20,7 +24,7 @@ struct Vertex
 
 struct Texture 
 {
-    unsigned int id;
+    TextureHandle handle;
     std::string path;
 };
 
@@ -35,67 +39,84 @@ enum
     rZ = 5
 };
 
-class Mesh
+// CPU-side geometry of one mesh before upload (as imported, or read from the mesh cache)
+struct MeshGeometry
 {
-public:
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
+    std::vector<std::string> texturePaths;
+};
+
+// Mesh prototype shared by every instance of a mesh (GPU handles plus optional CPU geometry).
+// Treated as immutable once uploaded, except that the CPU copy can be released.
+class MeshData
+{
+public:
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    unsigned int indexCount = 0;
     std::vector<Texture> textures;
-    glm::mat4 meshMatrix;
-    float mesh6DoF[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
-    float initRad = 0.0f;
-    float initRot = 0.0f;
 
-    // Init the mesh
-    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, const std::vector<Texture>& textures)
+    // Local bounds, computed at load time (kept when the CPU geometry is released)
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    glm::vec3 sphereCenter = glm::vec3(0.0f);
+    float sphereRadius = 0.0f;
+    float originRadius = 0.0f;      // Furthest vertex from the local origin
+
+    // CPU-side geometry, empty after releaseGeometry()
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+
+    // Upload the geometry to the GPU
+    MeshData(std::vector<Vertex> vertices, std::vector<unsigned int> indices, const std::vector<Texture>& textures)
+        : textures(textures)
+        , vertices(std::move(vertices))
+        , indices(std::move(indices))
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
+        indexCount = static_cast<unsigned int>(this->indices.size());
+        computeBounds();
         setupMesh();
+    }
 
-        // Init mesh matrix to identity
-        this->meshMatrix = glm::mat4(1);
+    // Not copyable, instances share one prototype through a pointer
+    MeshData(const MeshData&) = delete;
+    MeshData& operator=(const MeshData&) = delete;
+
+    // Check if the CPU copy of the geometry is still available
+    bool hasGeometry() const
+    {
+        return !vertices.empty();
     }
 
-    // Update mesh matrix
-    void updateModelMatrix()
+    // Drop the CPU copy of the geometry (the GPU buffers stay valid)
+    void releaseGeometry()
     {
-        meshMatrix = glm::mat4(1.0f); // Start with identity matrix
-        meshMatrix = glm::translate(meshMatrix, glm::vec3(mesh6DoF[tX], mesh6DoF[tY], mesh6DoF[tZ]));   // Apply translation
-        meshMatrix = glm::rotate(meshMatrix, mesh6DoF[rX], glm::vec3(1.0f, 0.0f, 0.0f));                // Rotate around X-axis
-        meshMatrix = glm::rotate(meshMatrix, mesh6DoF[rY], glm::vec3(0.0f, 1.0f, 0.0f));                // Rotate around Y-axis
-        meshMatrix = glm::rotate(meshMatrix, mesh6DoF[rZ], glm::vec3(0.0f, 0.0f, 1.0f));                // Rotate around Z-axis    
+        std::vector<Vertex>().swap(vertices);
+        std::vector<unsigned int>().swap(indices);
     }
 
-    // Draw the mesh
-    void draw(Shader& shader)
+private:
+    // AABB, bounding sphere around its centre, and radius around the origin
+    void computeBounds()
     {
-        // If multiple textures for this mesh, loop through
-        for (unsigned int i = 0; i < static_cast<unsigned int>(textures.size()); i++)
-        {
-            // Active proper texture unit before binding
-            glActiveTexture(GL_TEXTURE0 + i); 
- 
-            // Set the sampler to the correct texture unit
-            shader.setInt("textureDiffuse" + std::to_string(i), i);
+        if (vertices.empty())
+            return;
 
-            // Bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+        boundsMin = boundsMax = vertices[0].Position;
+        for (const Vertex& vertex : vertices)
+        {
+            boundsMin = glm::min(boundsMin, vertex.Position);
+            boundsMax = glm::max(boundsMax, vertex.Position);
         }
 
-        // Draw
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-
-        // Set active back to 0
-        glActiveTexture(GL_TEXTURE0);
+        sphereCenter = (boundsMin + boundsMax) * 0.5f;
+        for (const Vertex& vertex : vertices)
+        {
+            sphereRadius = glm::max(sphereRadius, glm::length(vertex.Position - sphereCenter));
+            originRadius = glm::max(originRadius, glm::length(vertex.Position));
+        }
     }
 
-private:
-    unsigned int VAO, VBO, EBO;
-
     // Setup
     void setupMesh()
     {
@@ -128,4 +149,115 @@ private:
         glBindVertexArray(0);
     }
 };
+
+// Per-instance mesh record: pose and matrix, plus a pointer to the shared prototype
+class Mesh
+{
+public:
+    std::shared_ptr<MeshData> data;
+    glm::mat4 meshMatrix;
+    float mesh6DoF[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    float initRad = 0.0f;
+    float initRot = 0.0f;
+
+    // Init the mesh (creates a new prototype)
+    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, const std::vector<Texture>& textures)
+        : Mesh(std::make_shared<MeshData>(std::move(vertices), std::move(indices), textures))
+    {
+    }
+
+    // Init the mesh from an existing prototype
+    Mesh(std::shared_ptr<MeshData> data)
+        : data(std::move(data))
+    {
+        // Init mesh matrix to identity
+        this->meshMatrix = glm::mat4(1);
+    }
+
+    // Update mesh matrix
+    void updateModelMatrix()
+    {
+        // Translation, then rotations around X, Y and Z, composed in closed form
+        meshMatrix = poseToMatrix(mesh6DoF[tX], mesh6DoF[tY], mesh6DoF[tZ], mesh6DoF[rX], mesh6DoF[rY], mesh6DoF[rZ]);
+    }
+
+    // Draw the mesh
+    void draw(Shader& shader)
+    {
+        bindTextures(shader);
+
+        // Draw
+        GLCounters::bindVertexArray(data->VAO);
+        GLCounters::drawElements(GL_TRIANGLES, data->indexCount, GL_UNSIGNED_INT, 0);
+        GLCounters::bindVertexArray(0);
+
+        // Set active back to 0
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // Attach a per-instance model matrix buffer to this mesh's VAO (attribute locations 3-6)
+    void setupInstanceBuffer(unsigned int instanceVBO)
+    {
+        glBindVertexArray(data->VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+
+        // A mat4 attribute takes up 4 consecutive vec4 locations, advanced once per instance
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            glEnableVertexAttribArray(3 + i);
+            glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(i * sizeof(glm::vec4)));
+            glVertexAttribDivisor(3 + i, 1);
+        }
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // Attach an extra float attribute (1-4 components) to this mesh's VAO
+    // (divisor 1 advances it per instance, 0 per vertex)
+    void setupAttribute(unsigned int VBO, unsigned int location, int numComponents, unsigned int stride, size_t offset, unsigned int divisor)
+    {
+        glBindVertexArray(data->VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, numComponents, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+        glVertexAttribDivisor(location, divisor);
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // Draw several instances of the mesh in one call (instance buffer must be set up first)
+    void drawInstanced(Shader& shader, unsigned int instanceCount)
+    {
+        bindTextures(shader);
+
+        // Draw
+        GLCounters::bindVertexArray(data->VAO);
+        GLCounters::drawElementsInstanced(GL_TRIANGLES, data->indexCount, GL_UNSIGNED_INT, 0, instanceCount);
+        GLCounters::bindVertexArray(0);
+
+        // Set active back to 0
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+private:
+    // Bind this mesh's textures to consecutive texture units
+    // (the shader's samplers are pointed at these units once, see main)
+    void bindTextures(Shader& shader)
+    {
+        const std::vector<Texture>& textures = data->textures;
+
+        // If multiple textures for this mesh, loop through
+        for (unsigned int i = 0; i < static_cast<unsigned int>(textures.size()); i++)
+        {
+            // Active proper texture unit before binding
+            glActiveTexture(GL_TEXTURE0 + i); 
+
+            // Bind the texture
+            GLCounters::bindTexture(GL_TEXTURE_2D, textures[i].handle->id);
+        }
+    }
+};
 #endif
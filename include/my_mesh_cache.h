@@ -0,0 +1,217 @@
+#ifndef MY_MESH_CACHE_H
+#define MY_MESH_CACHE_H
+
+#include <my_mapped_file.h>
+#include <my_mesh.h>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+// Cooked binary sidecar of an imported model ("<model>.obj.cooked"), so warm starts skip Assimp.
+// Layout: MeshCacheHeader, one MeshCacheEntry per submesh, then the vertex and index arrays,
+// then the texture paths (uint32 length + chars). Offsets are from the start of the file.
+const char MESH_CACHE_MAGIC[4] = { 'A', 'Q', 'M', 'C' };
+const uint32_t MESH_CACHE_VERSION = 1;     // Bump when the layout or the Vertex struct changes
+const char* const MESH_CACHE_EXTENSION = ".cooked";
+
+struct MeshCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t vertexSize;
+    uint32_t meshCount;
+
+    // Source files the cache was cooked from, a mismatch invalidates it
+    int64_t objWriteTime;
+    uint64_t objSize;
+    int64_t mtlWriteTime;
+    uint64_t mtlSize;
+};
+
+struct MeshCacheEntry
+{
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint64_t textureOffset;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t textureCount;
+    uint32_t pad;
+};
+
+// Modification time and size of a file (zero if missing)
+void getSourceStamp(const std::filesystem::path& path, int64_t& writeTime, uint64_t& size)
+{
+    std::error_code error;
+    writeTime = 0;
+    size = 0;
+
+    std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+    if (error)
+        return;
+    writeTime = static_cast<int64_t>(time.time_since_epoch().count());
+
+    uintmax_t fileSize = std::filesystem::file_size(path, error);
+    if (!error)
+        size = static_cast<uint64_t>(fileSize);
+}
+
+// Fill in the source stamps of a model (.obj plus its same-named .mtl)
+void getModelStamps(const std::string& objPath, MeshCacheHeader& header)
+{
+    std::filesystem::path mtlPath(objPath);
+    mtlPath.replace_extension(".mtl");
+
+    getSourceStamp(objPath, header.objWriteTime, header.objSize);
+    getSourceStamp(mtlPath, header.mtlWriteTime, header.mtlSize);
+}
+
+// Read a model's cooked sidecar, returns false if it is missing, corrupt or stale
+bool readMeshCache(const std::string& objPath, std::vector<MeshGeometry>& meshes)
+{
+    MappedFile file(objPath + MESH_CACHE_EXTENSION);
+    if (!file.isOpen() || file.size() < sizeof(MeshCacheHeader))
+        return false;
+
+    const unsigned char* bytes = file.data();
+    MeshCacheHeader header;
+    std::memcpy(&header, bytes, sizeof(header));
+
+    // Check format
+    if (std::memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != MESH_CACHE_VERSION ||
+        header.vertexSize != sizeof(Vertex))
+        return false;
+
+    // Check sources haven't changed since cooking
+    MeshCacheHeader current;
+    getModelStamps(objPath, current);
+    if (header.objWriteTime != current.objWriteTime || header.objSize != current.objSize ||
+        header.mtlWriteTime != current.mtlWriteTime || header.mtlSize != current.mtlSize)
+        return false;
+
+    if (file.size() < sizeof(MeshCacheHeader) + header.meshCount * sizeof(MeshCacheEntry))
+        return false;
+
+    std::vector<MeshGeometry> cached(header.meshCount);
+    for (uint32_t i = 0; i < header.meshCount; i++)
+    {
+        MeshCacheEntry entry;
+        std::memcpy(&entry, bytes + sizeof(MeshCacheHeader) + i * sizeof(MeshCacheEntry), sizeof(entry));
+
+        // Bounds check the arrays against the file
+        if (entry.vertexOffset + uint64_t(entry.vertexCount) * sizeof(Vertex) > file.size() ||
+            entry.indexOffset + uint64_t(entry.indexCount) * sizeof(unsigned int) > file.size() ||
+            entry.textureOffset > file.size())
+            return false;
+
+        // Vertices and indices straight out of the mapping
+        const Vertex* vertices = reinterpret_cast<const Vertex*>(bytes + entry.vertexOffset);
+        const unsigned int* indices = reinterpret_cast<const unsigned int*>(bytes + entry.indexOffset);
+        cached[i].vertices.assign(vertices, vertices + entry.vertexCount);
+        cached[i].indices.assign(indices, indices + entry.indexCount);
+
+        // Texture references
+        uint64_t offset = entry.textureOffset;
+        for (uint32_t j = 0; j < entry.textureCount; j++)
+        {
+            uint32_t length;
+            if (offset + sizeof(length) > file.size())
+                return false;
+            std::memcpy(&length, bytes + offset, sizeof(length));
+            offset += sizeof(length);
+
+            if (offset + length > file.size())
+                return false;
+            cached[i].texturePaths.emplace_back(reinterpret_cast<const char*>(bytes + offset), length);
+            offset += length;
+        }
+    }
+
+    meshes = std::move(cached);
+    return true;
+}
+
+// Cook a model's geometry into its sidecar (written to a temp file then renamed, so never half-written)
+bool writeMeshCache(const std::string& objPath, const std::vector<MeshGeometry>& meshes)
+{
+    MeshCacheHeader header;
+    std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+    header.version = MESH_CACHE_VERSION;
+    header.vertexSize = sizeof(Vertex);
+    header.meshCount = static_cast<uint32_t>(meshes.size());
+    getModelStamps(objPath, header);
+
+    // Lay out the arrays after the submesh table, texture paths at the end
+    std::vector<MeshCacheEntry> entries(meshes.size());
+    uint64_t offset = sizeof(MeshCacheHeader) + meshes.size() * sizeof(MeshCacheEntry);
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        entries[i].vertexCount = static_cast<uint32_t>(meshes[i].vertices.size());
+        entries[i].indexCount = static_cast<uint32_t>(meshes[i].indices.size());
+        entries[i].textureCount = static_cast<uint32_t>(meshes[i].texturePaths.size());
+        entries[i].pad = 0;
+
+        entries[i].vertexOffset = offset;
+        offset += meshes[i].vertices.size() * sizeof(Vertex);
+        entries[i].indexOffset = offset;
+        offset += meshes[i].indices.size() * sizeof(unsigned int);
+    }
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        entries[i].textureOffset = offset;
+        for (const std::string& texturePath : meshes[i].texturePaths)
+            offset += sizeof(uint32_t) + texturePath.size();
+    }
+
+    std::string cachePath = objPath + MESH_CACHE_EXTENSION;
+    std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            std::cout << "ERROR::MESH_CACHE::FAILED_TO_WRITE: " << cachePath << std::endl;
+            return false;
+        }
+
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(MeshCacheEntry));
+        for (const MeshGeometry& mesh : meshes)
+        {
+            out.write(reinterpret_cast<const char*>(mesh.vertices.data()), mesh.vertices.size() * sizeof(Vertex));
+            out.write(reinterpret_cast<const char*>(mesh.indices.data()), mesh.indices.size() * sizeof(unsigned int));
+        }
+        for (const MeshGeometry& mesh : meshes)
+        {
+            for (const std::string& texturePath : mesh.texturePaths)
+            {
+                uint32_t length = static_cast<uint32_t>(texturePath.size());
+                out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+                out.write(texturePath.data(), length);
+            }
+        }
+
+        if (!out)
+        {
+            std::cout << "ERROR::MESH_CACHE::FAILED_TO_WRITE: " << cachePath << std::endl;
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, cachePath, error);
+    if (error)
+    {
+        std::cout << "ERROR::MESH_CACHE::FAILED_TO_WRITE: " << cachePath << " (" << error.message() << ")" << std::endl;
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
+#endif // MY_MESH_CACHE_H
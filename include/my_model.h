@@ -6,13 +6,15 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
-#include <stb_image.h>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
 #include <my_mesh.h>
+#include <my_mesh_cache.h>
 #include <my_shader.h>
+#include <my_texture_registry.h>
+#include <my_trace.h>
 
 #include <string>
 #include <fstream>
@@ -21,9 +23,6 @@
 #include <map>
 #include <vector>
 
-// Forward declare
-unsigned int loadTexture(const char* texturePath);
-
 class Model
 {
 public:
@@ -33,21 +32,47 @@ public:
     // Constructor (expects a filepath to a 3D model)
     Model(std::string const& objPath)
     {
-        loadModel(objPath);
+        std::vector<MeshGeometry> geometry;
+        if (loadGeometry(objPath, geometry))
+            uploadMeshes(geometry);
     }
 
-    // Draw the model (all its meshes)
-    void draw(Shader& shader)
+    // Constructor from geometry loaded earlier (see loadGeometry), must run on the GL thread
+    Model(std::vector<MeshGeometry>& geometry)
     {
-        for (unsigned int i = 0; i < static_cast<unsigned int>(meshes.size()); i++)
-            meshes[i].draw(shader);
+        uploadMeshes(geometry);
     }
 
-private:
-    // Load a 3D model specified by path
-    void loadModel(std::string const& path)
+    // Load a model's CPU-side geometry, from its cooked cache if it is up to date.
+    // Makes no GL calls, so it can run on any thread.
+    static bool loadGeometry(std::string const& path, std::vector<MeshGeometry>& geometry, bool* fromCache = nullptr)
+    {
+        bool cached;
+        {
+            TraceSpan span("model", "read cache", path);
+            cached = readMeshCache(path, geometry);
+        }
+        if (cached)
+        {
+            if (fromCache)
+                *fromCache = true;
+            return true;
+        }
+
+        if (fromCache)
+            *fromCache = false;
+        if (!importModel(path, geometry))
+            return false;
+        TraceSpan span("model", "write cache", path);
+        writeMeshCache(path, geometry);
+        return true;
+    }
+
+    // Read a model file with Assimp into CPU-side geometry (no cache, makes no GL calls)
+    static bool importModel(std::string const& path, std::vector<MeshGeometry>& geometry)
     {
         // Read file
+        TraceSpan span("model", "assimp import", path);
         Assimp::Importer importer;
         const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
         
@@ -55,33 +80,68 @@ private:
         if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
         {
             std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
-            return;
+            return false;
         }
 
         // Process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        processNode(scene->mRootNode, scene, geometry);
+        return true;
+    }
+
+    // Radius around the model origin that contains every mesh. Also holds for hierarchies that
+    // only rotate meshes about the origin (kelp segments, tail wag).
+    float getBoundingRadius() const
+    {
+        float radius = 0.0f;
+        for (const Mesh& mesh : meshes)
+            radius = glm::max(radius, mesh.data->originRadius);
+        return radius;
+    }
+
+    // Drop the CPU copy of the geometry of every mesh (shared by all instances of this model)
+    void releaseGeometry()
+    {
+        for (Mesh& mesh : meshes)
+            mesh.data->releaseGeometry();
+    }
+
+    // Draw the model (all its meshes)
+    void draw(Shader& shader)
+    {
+        for (unsigned int i = 0; i < static_cast<unsigned int>(meshes.size()); i++)
+            meshes[i].draw(shader);
+    }
+
+private:
+    // Create the GL objects for each mesh and request its textures
+    void uploadMeshes(std::vector<MeshGeometry>& geometry)
+    {
+        for (MeshGeometry& mesh : geometry)
+            meshes.push_back(Mesh(std::move(mesh.vertices), std::move(mesh.indices), loadMaterialTextures(mesh.texturePaths)));
     }
 
     // Processes a node recursively
-    void processNode(aiNode* node, const aiScene* scene)
+    static void processNode(aiNode* node, const aiScene* scene, std::vector<MeshGeometry>& geometry)
     {
         // Process each mesh located at current node
         for (unsigned int i = 0; i < node->mNumMeshes; i++)
         {
             aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            geometry.push_back(processMesh(mesh, scene));
         }
         // Recursively process children nodes
         for (unsigned int i = 0; i < node->mNumChildren; i++)
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, geometry);
     }
 
-    Mesh processMesh(aiMesh* mesh, const aiScene* scene)
+    static MeshGeometry processMesh(aiMesh* mesh, const aiScene* scene)
     {
         // Data to fill
-        std::vector<Vertex> vertices;
-        std::vector<unsigned int> indices;
-        std::vector<Texture> textures;
+        MeshGeometry geometry;
+        std::vector<Vertex>& vertices = geometry.vertices;
+        std::vector<unsigned int>& indices = geometry.indices;
+        vertices.reserve(mesh->mNumVertices);
+        indices.reserve(mesh->mNumFaces * 3);
 
         // Loop through mesh's vertices
         for (unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -133,62 +193,28 @@ private:
         aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
         
         // Only using diffuse textures
-        std::vector<Texture> textureMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE);
-        textures.insert(textures.end(), textureMaps.begin(), textureMaps.end());
+        for (unsigned int i = 0; i < material->GetTextureCount(aiTextureType_DIFFUSE); i++)
+        {
+            aiString str;
+            material->GetTexture(aiTextureType_DIFFUSE, i, &str);
+            geometry.texturePaths.push_back(str.C_Str());
+        }
 
-        // Return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        return geometry;
     }
 
     // Load materials
-    std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type)
+    std::vector<Texture> loadMaterialTextures(const std::vector<std::string>& texturePaths)
     {
         std::vector<Texture> textures;
-        for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+        for (const std::string& texturePath : texturePaths)
         {
-            aiString str;
-            mat->GetTexture(type, i, &str);
             Texture texture;
-            texture.id = loadTexture(str.C_Str());
-            texture.path = str.C_Str();
+            texture.handle = loadTexture(texturePath.c_str());
+            texture.path = texturePath;
             textures.push_back(texture);
         }
         return textures;
     }
 };
-
-unsigned int loadTexture(const char* texturePath)
-{
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    stbi_set_flip_vertically_on_load(false);
-    int width, height, numChannels;
-    unsigned char* data = stbi_load(texturePath, &width, &height, &numChannels, 0);
-    if (data)
-    {
-        GLenum format = GL_RGB;
-        if (numChannels == 1)
-            format = GL_RED;
-        else if (numChannels == 3)
-            format = GL_RGB;
-        else if (numChannels == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    }
-    else
-        std::cout << "Texture failed to load at path: " << texturePath << std::endl;
-
-    stbi_image_free(data);
-
-    return textureID;
-}
 #endif // MY_MODEL_H
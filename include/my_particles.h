@@ -0,0 +1,362 @@
+#ifndef MY_PARTICLES_H
+#define MY_PARTICLES_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <my_gl_counters.h>
+#include <my_shader.h>
+
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+// Texture unit the update pass reads the owner generations from (units 0-3 are the mesh textures)
+const int PARTICLE_OWNER_TEXTURE_UNIT = 4;
+
+// One particle as stored on the GPU, three vec4 attributes
+struct Particle
+{
+    glm::vec3 position = glm::vec3(0.0f);
+    float age = 0.0f;                   // Seconds alive, negative while waiting to start
+    glm::vec3 velocity = glm::vec3(0.0f);
+    float lifetime = -1.0f;             // Negative for an empty slot
+    float ownerSlot = -1.0f;            // Entity the particle belongs to (dies with it), -1 for none
+    float ownerGeneration = 0.0f;
+    float size = 0.02f;                 // Billboard half size
+    float seed = 0.0f;                  // 0 to 1, varies the wobble between particles
+};
+static_assert(sizeof(Particle) == 48, "Particle must match the vertex attribute layout");
+
+// How the update pass moves particles (distances in world units, times in seconds)
+struct ParticleBehavior
+{
+    glm::vec3 acceleration = glm::vec3(0.0f);   // Gravity or buoyancy
+    float drag = 0.0f;                          // Fraction of the velocity lost per second
+    float wobbleAmplitude = 0.0f;               // Sideways sway speed
+    float wobbleFrequency = 1.0f;
+    float floorHeight = -1000.0f;               // Particles die outside [floorHeight, ceilingHeight]
+    float ceilingHeight = 1000.0f;
+
+    // Expired particles restart at the emitter, a continuous stream with no CPU work
+    bool respawn = false;
+    glm::vec3 emitterPosition = glm::vec3(0.0f);
+    float emitterRadius = 0.0f;
+    glm::vec3 emitVelocity = glm::vec3(0.0f);
+    float emitVelocitySpread = 0.0f;
+    glm::vec2 lifetimeRange = glm::vec2(1.0f, 2.0f);
+    glm::vec2 sizeRange = glm::vec2(0.01f, 0.02f);
+};
+
+// Check if two behaviours would upload the same uniforms
+bool operator==(const ParticleBehavior& a, const ParticleBehavior& b)
+{
+    return a.acceleration == b.acceleration && a.drag == b.drag && a.wobbleAmplitude == b.wobbleAmplitude
+        && a.wobbleFrequency == b.wobbleFrequency && a.floorHeight == b.floorHeight && a.ceilingHeight == b.ceilingHeight
+        && a.respawn == b.respawn && a.emitterPosition == b.emitterPosition && a.emitterRadius == b.emitterRadius
+        && a.emitVelocity == b.emitVelocity && a.emitVelocitySpread == b.emitVelocitySpread
+        && a.lifetimeRange == b.lifetimeRange && a.sizeRange == b.sizeRange;
+}
+
+// GPU particle engine. Particle state lives in two buffers: each step a vertex-only pass reads one and writes
+// the other through transform feedback (with rasterisation off), then they swap. Drawing instances a
+// camera-facing quad per particle straight from the current buffer, so the CPU never touches a particle
+// after emitting it.
+class ParticleSystem
+{
+public:
+    ParticleBehavior behavior;
+
+    // Constructor (a respawning system starts full, its particles staggered so the stream starts steady)
+    ParticleSystem(unsigned int capacity, const ParticleBehavior& particleBehavior, unsigned int seed = 1234)
+        : behavior(particleBehavior), capacity(std::max(1u, capacity)), systemID(nextSystemID()++)
+    {
+        std::vector<Particle> particles(this->capacity);
+        if (behavior.respawn)
+        {
+            std::mt19937 random(seed);
+            std::uniform_real_distribution<float> delay(0.0f, behavior.lifetimeRange.y);
+            for (Particle& particle : particles)
+            {
+                particle.age = -delay(random);
+                particle.lifetime = 0.0f;
+                particle.size = 0.0f;
+            }
+        }
+        pendingIndices.reserve(this->capacity);
+        pendingParticles.reserve(this->capacity);
+
+        // Both state buffers, an update VAO reading each and a render VAO instancing each
+        glGenBuffers(2, stateVBOs);
+        glGenVertexArrays(2, updateVAOs);
+        glGenVertexArrays(2, renderVAOs);
+
+        static const float corners[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+        glGenBuffers(1, &quadVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+
+        for (unsigned int i = 0; i < 2; i++)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, stateVBOs[i]);
+            glBufferData(GL_ARRAY_BUFFER, this->capacity * sizeof(Particle), particles.data(), GL_DYNAMIC_COPY);
+
+            glBindVertexArray(updateVAOs[i]);
+            setupParticleAttributes(stateVBOs[i], 0, 0);
+
+            glBindVertexArray(renderVAOs[i]);
+            glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+            setupParticleAttributes(stateVBOs[i], 1, 1);
+        }
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        // Owner generations, read with texelFetch in the update pass
+        glGenBuffers(1, &ownerTBO);
+        glGenTextures(1, &ownerTexture);
+        glBindBuffer(GL_TEXTURE_BUFFER, ownerTBO);
+        glBufferData(GL_TEXTURE_BUFFER, sizeof(int), NULL, GL_DYNAMIC_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, ownerTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32I, ownerTBO);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    // Current generation of every owner slot (uploaded as is, one int per slot)
+    void setOwnerGenerations(const unsigned int* generations, unsigned int count)
+    {
+        glBindBuffer(GL_TEXTURE_BUFFER, ownerTBO);
+        if (count > ownerCapacity)
+        {
+            ownerCapacity = count;
+            glBufferData(GL_TEXTURE_BUFFER, count * sizeof(unsigned int), generations, GL_DYNAMIC_DRAW);
+        }
+        else
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, count * sizeof(unsigned int), generations);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        useOwners = true;
+    }
+
+    // Queue a particle, written into slot index at the next update (replacing whatever is there).
+    // Callers own fixed ranges of slots, so nothing still alive is overwritten by someone else's particles.
+    void emit(unsigned int index, const Particle& particle)
+    {
+        if (index >= capacity)
+            return;
+        pendingIndices.push_back(index);
+        pendingParticles.push_back(particle);
+    }
+
+    // Run one update pass per simulation step (time is that of the last step), then write the queued particles
+    // (emitted as of the last step)
+    void update(Shader& updateShader, float time, float stepSeconds, unsigned int steps)
+    {
+        if (steps == 0)
+        {
+            flushEmitted();
+            return;
+        }
+
+        updateShader.use();
+        setBehaviorUniforms(updateShader);
+        updateUniforms.stepSeconds.set(stepSeconds);
+        updateUniforms.useOwners.set(useOwners);
+        glActiveTexture(GL_TEXTURE0 + PARTICLE_OWNER_TEXTURE_UNIT);
+        GLCounters::bindTexture(GL_TEXTURE_BUFFER, ownerTexture);
+
+        glEnable(GL_RASTERIZER_DISCARD);
+        for (unsigned int s = 0; s < steps; s++)
+        {
+            updateUniforms.time.set(time - (steps - 1 - s) * stepSeconds);
+            updateUniforms.stepIndex.set(static_cast<int>(stepIndex++));
+
+            unsigned int target = 1 - current;
+            GLCounters::bindVertexArray(updateVAOs[current]);
+            glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, stateVBOs[target]);
+            glBeginTransformFeedback(GL_POINTS);
+            GLCounters::drawArrays(GL_POINTS, 0, capacity);
+            glEndTransformFeedback();
+            current = target;
+        }
+        glDisable(GL_RASTERIZER_DISCARD);
+
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+        GLCounters::bindVertexArray(0);
+        GLCounters::bindTexture(GL_TEXTURE_BUFFER, 0);
+        glActiveTexture(GL_TEXTURE0);
+        flushEmitted();
+    }
+
+    // Draw every live particle as a billboard, drawn renderLag seconds behind the last step to match the interpolated scene
+    void draw(Shader& renderShader, float renderLag, const glm::vec4& color, bool bubbleShading)
+    {
+        // Resolve the uniform handles once per program
+        if (renderShader.ID != renderUniforms.programID)
+        {
+            renderUniforms.renderLag = renderShader.uniform<float>("renderLag");
+            renderUniforms.particleColor = renderShader.uniform<glm::vec4>("particleColor");
+            renderUniforms.bubbleShading = renderShader.uniform<bool>("bubbleShading");
+            renderUniforms.programID = renderShader.ID;
+        }
+
+        renderShader.use();
+        renderUniforms.renderLag.set(renderLag);
+        renderUniforms.particleColor.set(color);
+        renderUniforms.bubbleShading.set(bubbleShading);
+
+        GLCounters::bindVertexArray(renderVAOs[current]);
+        GLCounters::drawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, capacity);
+        GLCounters::bindVertexArray(0);
+    }
+
+    unsigned int getCapacity() const
+    {
+        return capacity;
+    }
+
+private:
+    // Uniform handles of the update program
+    struct UpdateUniforms
+    {
+        GLuint programID = 0;
+        Uniform<float> stepSeconds, time;
+        Uniform<int> stepIndex;
+        Uniform<glm::vec3> acceleration;
+        Uniform<float> drag, wobbleAmplitude, wobbleFrequency, floorHeight, ceilingHeight;
+        Uniform<bool> respawn;
+        Uniform<glm::vec3> emitterPosition;
+        Uniform<float> emitterRadius;
+        Uniform<glm::vec3> emitVelocity;
+        Uniform<float> emitVelocitySpread;
+        Uniform<glm::vec2> lifetimeRange, sizeRange;
+        Uniform<bool> useOwners;
+        Uniform<int> ownerGenerations;
+    };
+
+    // Uniform handles of the render program
+    struct RenderUniforms
+    {
+        GLuint programID = 0;
+        Uniform<float> renderLag;
+        Uniform<glm::vec4> particleColor;
+        Uniform<bool> bubbleShading;
+    };
+
+    unsigned int capacity;
+    unsigned int systemID;              // Tells apart the systems sharing an update program
+    UpdateUniforms updateUniforms;
+    RenderUniforms renderUniforms;
+    ParticleBehavior uploadedBehavior;  // Behaviour last uploaded by this system
+    unsigned int current = 0;           // State buffer holding the latest step
+    unsigned int stepIndex = 0;         // Seeds the update pass's random numbers
+    unsigned int stateVBOs[2];
+    unsigned int updateVAOs[2];
+    unsigned int renderVAOs[2];
+    unsigned int quadVBO;
+    unsigned int ownerTBO;
+    unsigned int ownerTexture;
+    unsigned int ownerCapacity = 0;
+    bool useOwners = false;
+    std::vector<unsigned int> pendingIndices;
+    std::vector<Particle> pendingParticles;
+
+    static unsigned int& nextSystemID()
+    {
+        static unsigned int id = 1;
+        return id;
+    }
+
+    // System whose behaviour each update program currently holds (systems can share a program)
+    static std::unordered_map<GLuint, unsigned int>& getBehaviorOwners()
+    {
+        static std::unordered_map<GLuint, unsigned int> owners;
+        return owners;
+    }
+
+    // Resolve the update program's handles, and upload the behaviour if the program doesn't already hold it (program in use)
+    void setBehaviorUniforms(Shader& updateShader)
+    {
+        UpdateUniforms& u = updateUniforms;
+        bool newProgram = updateShader.ID != u.programID;
+        if (newProgram)
+        {
+            u.stepSeconds = updateShader.uniform<float>("stepSeconds");
+            u.time = updateShader.uniform<float>("time");
+            u.stepIndex = updateShader.uniform<int>("stepIndex");
+            u.acceleration = updateShader.uniform<glm::vec3>("acceleration");
+            u.drag = updateShader.uniform<float>("drag");
+            u.wobbleAmplitude = updateShader.uniform<float>("wobbleAmplitude");
+            u.wobbleFrequency = updateShader.uniform<float>("wobbleFrequency");
+            u.floorHeight = updateShader.uniform<float>("floorHeight");
+            u.ceilingHeight = updateShader.uniform<float>("ceilingHeight");
+            u.respawn = updateShader.uniform<bool>("respawn");
+            u.emitterPosition = updateShader.uniform<glm::vec3>("emitterPosition");
+            u.emitterRadius = updateShader.uniform<float>("emitterRadius");
+            u.emitVelocity = updateShader.uniform<glm::vec3>("emitVelocity");
+            u.emitVelocitySpread = updateShader.uniform<float>("emitVelocitySpread");
+            u.lifetimeRange = updateShader.uniform<glm::vec2>("lifetimeRange");
+            u.sizeRange = updateShader.uniform<glm::vec2>("sizeRange");
+            u.useOwners = updateShader.uniform<bool>("useOwners");
+            u.ownerGenerations = updateShader.uniform<int>("ownerGenerations");
+            u.programID = updateShader.ID;
+        }
+
+        unsigned int& owner = getBehaviorOwners()[updateShader.ID];
+        if (!newProgram && owner == systemID && behavior == uploadedBehavior)
+            return;
+        u.acceleration.set(behavior.acceleration);
+        u.drag.set(behavior.drag);
+        u.wobbleAmplitude.set(behavior.wobbleAmplitude);
+        u.wobbleFrequency.set(behavior.wobbleFrequency);
+        u.floorHeight.set(behavior.floorHeight);
+        u.ceilingHeight.set(behavior.ceilingHeight);
+        u.respawn.set(behavior.respawn);
+        u.emitterPosition.set(behavior.emitterPosition);
+        u.emitterRadius.set(behavior.emitterRadius);
+        u.emitVelocity.set(behavior.emitVelocity);
+        u.emitVelocitySpread.set(behavior.emitVelocitySpread);
+        u.lifetimeRange.set(behavior.lifetimeRange);
+        u.sizeRange.set(behavior.sizeRange);
+        u.ownerGenerations.set(PARTICLE_OWNER_TEXTURE_UNIT);
+        owner = systemID;
+        uploadedBehavior = behavior;
+    }
+
+    // The three vec4s of a particle at consecutive locations (divisor 1 to advance per instance)
+    void setupParticleAttributes(unsigned int VBO, unsigned int firstLocation, unsigned int divisor)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        for (unsigned int i = 0; i < 3; i++)
+        {
+            glEnableVertexAttribArray(firstLocation + i);
+            glVertexAttribPointer(firstLocation + i, 4, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)(i * sizeof(glm::vec4)));
+            glVertexAttribDivisor(firstLocation + i, divisor);
+        }
+    }
+
+    // Copy the queued particles into their slots of the current buffer, one write per run of consecutive slots
+    void flushEmitted()
+    {
+        if (pendingParticles.empty())
+            return;
+
+        glBindBuffer(GL_ARRAY_BUFFER, stateVBOs[current]);
+        unsigned int count = static_cast<unsigned int>(pendingParticles.size());
+        unsigned int runStart = 0;
+        for (unsigned int i = 1; i <= count; i++)
+        {
+            if (i < count && pendingIndices[i] == pendingIndices[i - 1] + 1)
+                continue;
+            glBufferSubData(GL_ARRAY_BUFFER, pendingIndices[runStart] * sizeof(Particle), (i - runStart) * sizeof(Particle), &pendingParticles[runStart]);
+            runStart = i;
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        pendingIndices.clear();
+        pendingParticles.clear();
+    }
+};
+#endif // MY_PARTICLES_H
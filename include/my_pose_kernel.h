@@ -0,0 +1,319 @@
+#ifndef MY_POSE_KERNEL_H
+#define MY_POSE_KERNEL_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+// Vector paths available in this build (AVX2 needs /arch:AVX2 or -mavx2, SSE2 is always there on x64)
+#if defined(__AVX2__)
+#define MY_POSE_KERNEL_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MY_POSE_KERNEL_SSE
+#endif
+#if defined(MY_POSE_KERNEL_AVX2) || defined(MY_POSE_KERNEL_SSE)
+#include <immintrin.h>
+#endif
+
+// Instruction set a batch of poses is processed with
+enum class PoseKernelPath
+{
+    Scalar,
+    SSE,
+    AVX2
+};
+
+// N 6DoF poses as one array per parameter, rotations in radians
+struct PoseArrays
+{
+    const float* transX;
+    const float* transY;
+    const float* transZ;
+    const float* rotX;
+    const float* rotY;
+    const float* rotZ;
+};
+
+// Widest path compiled in
+PoseKernelPath getBestPoseKernelPath()
+{
+#if defined(MY_POSE_KERNEL_AVX2)
+    return PoseKernelPath::AVX2;
+#elif defined(MY_POSE_KERNEL_SSE)
+    return PoseKernelPath::SSE;
+#else
+    return PoseKernelPath::Scalar;
+#endif
+}
+
+// Name of a path, for reports
+const char* getPoseKernelPathName(PoseKernelPath path)
+{
+    switch (path)
+    {
+    case PoseKernelPath::AVX2: return "AVX2";
+    case PoseKernelPath::SSE: return "SSE";
+    default: return "scalar";
+    }
+}
+
+// translate(T) * rotate(X) * rotate(Y) * rotate(Z) from the sines and cosines, written as 16 column-major floats.
+// Same result as the translate and three glm::rotate calls, without building the axis-angle matrices.
+void writePoseMatrix(float* out, float transX, float transY, float transZ,
+    float sinX, float cosX, float sinY, float cosY, float sinZ, float cosZ)
+{
+    out[0] = cosY * cosZ;
+    out[1] = sinX * sinY * cosZ + cosX * sinZ;
+    out[2] = sinX * sinZ - cosX * sinY * cosZ;
+    out[3] = 0.0f;
+
+    out[4] = -cosY * sinZ;
+    out[5] = cosX * cosZ - sinX * sinY * sinZ;
+    out[6] = cosX * sinY * sinZ + sinX * cosZ;
+    out[7] = 0.0f;
+
+    out[8] = sinY;
+    out[9] = -sinX * cosY;
+    out[10] = cosX * cosY;
+    out[11] = 0.0f;
+
+    out[12] = transX;
+    out[13] = transY;
+    out[14] = transZ;
+    out[15] = 1.0f;
+}
+
+// World matrix of a single pose
+glm::mat4 poseToMatrix(float transX, float transY, float transZ, float rotX, float rotY, float rotZ)
+{
+    glm::mat4 matrix;
+    writePoseMatrix(&matrix[0][0], transX, transY, transZ,
+        std::sin(rotX), std::cos(rotX), std::sin(rotY), std::cos(rotY), std::sin(rotZ), std::cos(rotZ));
+    return matrix;
+}
+
+#if defined(MY_POSE_KERNEL_SSE)
+// Sine and cosine of 4 angles (Cephes single precision polynomials, about 1e-7 absolute error)
+void sinCos4(__m128 x, __m128& sines, __m128& cosines)
+{
+    const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(0x80000000)));
+    __m128 signSin = _mm_and_ps(x, signMask);
+    x = _mm_andnot_ps(signMask, x);
+
+    // Octant of |x| (rounded up to even) and the signs and polynomial it selects
+    __m128i octant = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.27323954473516f)));
+    octant = _mm_and_si128(_mm_add_epi32(octant, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+    __m128 y = _mm_cvtepi32_ps(octant);
+    signSin = _mm_xor_ps(signSin, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, _mm_set1_epi32(4)), 29)));
+    __m128 signCos = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(octant, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+    __m128 sinPolyMask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(octant, _mm_set1_epi32(2)), _mm_setzero_si128()));
+
+    // x - octant * pi/4 in three parts to keep precision
+    x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-0.78515625f)));
+    x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-2.4187564849853515625e-4f)));
+    x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-3.77489497744594108e-8f)));
+    __m128 z = _mm_mul_ps(x, x);
+
+    // Cosine and sine polynomials on [-pi/4, pi/4]
+    __m128 cosPoly = _mm_set1_ps(2.443315711809948e-5f);
+    cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(-1.388731625493765e-3f));
+    cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(4.166664568298827e-2f));
+    cosPoly = _mm_mul_ps(_mm_mul_ps(cosPoly, z), z);
+    cosPoly = _mm_add_ps(_mm_sub_ps(cosPoly, _mm_mul_ps(z, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+    __m128 sinPoly = _mm_set1_ps(-1.9515295891e-4f);
+    sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(8.3321608736e-3f));
+    sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(-1.6666654611e-1f));
+    sinPoly = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPoly, z), x), x);
+
+    sines = _mm_xor_ps(_mm_or_ps(_mm_and_ps(sinPolyMask, sinPoly), _mm_andnot_ps(sinPolyMask, cosPoly)), signSin);
+    cosines = _mm_xor_ps(_mm_or_ps(_mm_and_ps(sinPolyMask, cosPoly), _mm_andnot_ps(sinPolyMask, sinPoly)), signCos);
+}
+
+// Store 4 matrices from their 9 rotation terms and translations (one pose per lane)
+void storePoseMatrices4(float* out, const __m128 rotation[9], __m128 transX, __m128 transY, __m128 transZ)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128 columns[4][4] =
+    {
+        { rotation[0], rotation[3], rotation[6], zero },
+        { rotation[1], rotation[4], rotation[7], zero },
+        { rotation[2], rotation[5], rotation[8], zero },
+        { transX, transY, transZ, one },
+    };
+
+    // Lane k of each column goes to matrix k
+    for (int c = 0; c < 4; c++)
+    {
+        _MM_TRANSPOSE4_PS(columns[c][0], columns[c][1], columns[c][2], columns[c][3]);
+        for (int k = 0; k < 4; k++)
+            _mm_storeu_ps(out + k * 16 + c * 4, columns[c][k]);
+    }
+}
+
+// Poses [first, first + 4)
+void computePoseMatrices4(const PoseArrays& poses, unsigned int first, float* out)
+{
+    __m128 sinX, cosX, sinY, cosY, sinZ, cosZ;
+    sinCos4(_mm_loadu_ps(poses.rotX + first), sinX, cosX);
+    sinCos4(_mm_loadu_ps(poses.rotY + first), sinY, cosY);
+    sinCos4(_mm_loadu_ps(poses.rotZ + first), sinZ, cosZ);
+
+    // Row-major terms of the rotation, see writePoseMatrix
+    __m128 sinXsinY = _mm_mul_ps(sinX, sinY);
+    __m128 cosXsinY = _mm_mul_ps(cosX, sinY);
+    __m128 rotation[9] =
+    {
+        _mm_mul_ps(cosY, cosZ),
+        _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(cosY, sinZ)),
+        sinY,
+        _mm_add_ps(_mm_mul_ps(sinXsinY, cosZ), _mm_mul_ps(cosX, sinZ)),
+        _mm_sub_ps(_mm_mul_ps(cosX, cosZ), _mm_mul_ps(sinXsinY, sinZ)),
+        _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(sinX, cosY)),
+        _mm_sub_ps(_mm_mul_ps(sinX, sinZ), _mm_mul_ps(cosXsinY, cosZ)),
+        _mm_add_ps(_mm_mul_ps(cosXsinY, sinZ), _mm_mul_ps(sinX, cosZ)),
+        _mm_mul_ps(cosX, cosY),
+    };
+
+    storePoseMatrices4(out, rotation,
+        _mm_loadu_ps(poses.transX + first), _mm_loadu_ps(poses.transY + first), _mm_loadu_ps(poses.transZ + first));
+}
+#endif
+
+#if defined(MY_POSE_KERNEL_AVX2)
+// Sine and cosine of 8 angles, same method as sinCos4
+void sinCos8(__m256 x, __m256& sines, __m256& cosines)
+{
+    const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32(static_cast<int>(0x80000000)));
+    __m256 signSin = _mm256_and_ps(x, signMask);
+    x = _mm256_andnot_ps(signMask, x);
+
+    __m256i octant = _mm256_cvttps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(1.27323954473516f)));
+    octant = _mm256_and_si256(_mm256_add_epi32(octant, _mm256_set1_epi32(1)), _mm256_set1_epi32(~1));
+    __m256 y = _mm256_cvtepi32_ps(octant);
+    signSin = _mm256_xor_ps(signSin, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(octant, _mm256_set1_epi32(4)), 29)));
+    __m256 signCos = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_andnot_si256(_mm256_sub_epi32(octant, _mm256_set1_epi32(2)), _mm256_set1_epi32(4)), 29));
+    __m256 sinPolyMask = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(octant, _mm256_set1_epi32(2)), _mm256_setzero_si256()));
+
+    x = _mm256_add_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(-0.78515625f)));
+    x = _mm256_add_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(-2.4187564849853515625e-4f)));
+    x = _mm256_add_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(-3.77489497744594108e-8f)));
+    __m256 z = _mm256_mul_ps(x, x);
+
+    __m256 cosPoly = _mm256_set1_ps(2.443315711809948e-5f);
+    cosPoly = _mm256_add_ps(_mm256_mul_ps(cosPoly, z), _mm256_set1_ps(-1.388731625493765e-3f));
+    cosPoly = _mm256_add_ps(_mm256_mul_ps(cosPoly, z), _mm256_set1_ps(4.166664568298827e-2f));
+    cosPoly = _mm256_mul_ps(_mm256_mul_ps(cosPoly, z), z);
+    cosPoly = _mm256_add_ps(_mm256_sub_ps(cosPoly, _mm256_mul_ps(z, _mm256_set1_ps(0.5f))), _mm256_set1_ps(1.0f));
+
+    __m256 sinPoly = _mm256_set1_ps(-1.9515295891e-4f);
+    sinPoly = _mm256_add_ps(_mm256_mul_ps(sinPoly, z), _mm256_set1_ps(8.3321608736e-3f));
+    sinPoly = _mm256_add_ps(_mm256_mul_ps(sinPoly, z), _mm256_set1_ps(-1.6666654611e-1f));
+    sinPoly = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(sinPoly, z), x), x);
+
+    sines = _mm256_xor_ps(_mm256_blendv_ps(cosPoly, sinPoly, sinPolyMask), signSin);
+    cosines = _mm256_xor_ps(_mm256_blendv_ps(sinPoly, cosPoly, sinPolyMask), signCos);
+}
+
+// Poses [first, first + 8), stored as two groups of 4 through the SSE transpose
+void computePoseMatrices8(const PoseArrays& poses, unsigned int first, float* out)
+{
+    __m256 sinX, cosX, sinY, cosY, sinZ, cosZ;
+    sinCos8(_mm256_loadu_ps(poses.rotX + first), sinX, cosX);
+    sinCos8(_mm256_loadu_ps(poses.rotY + first), sinY, cosY);
+    sinCos8(_mm256_loadu_ps(poses.rotZ + first), sinZ, cosZ);
+
+    __m256 sinXsinY = _mm256_mul_ps(sinX, sinY);
+    __m256 cosXsinY = _mm256_mul_ps(cosX, sinY);
+    __m256 rotation[9] =
+    {
+        _mm256_mul_ps(cosY, cosZ),
+        _mm256_sub_ps(_mm256_setzero_ps(), _mm256_mul_ps(cosY, sinZ)),
+        sinY,
+        _mm256_add_ps(_mm256_mul_ps(sinXsinY, cosZ), _mm256_mul_ps(cosX, sinZ)),
+        _mm256_sub_ps(_mm256_mul_ps(cosX, cosZ), _mm256_mul_ps(sinXsinY, sinZ)),
+        _mm256_sub_ps(_mm256_setzero_ps(), _mm256_mul_ps(sinX, cosY)),
+        _mm256_sub_ps(_mm256_mul_ps(sinX, sinZ), _mm256_mul_ps(cosXsinY, cosZ)),
+        _mm256_add_ps(_mm256_mul_ps(cosXsinY, sinZ), _mm256_mul_ps(sinX, cosZ)),
+        _mm256_mul_ps(cosX, cosY),
+    };
+    __m256 transX = _mm256_loadu_ps(poses.transX + first);
+    __m256 transY = _mm256_loadu_ps(poses.transY + first);
+    __m256 transZ = _mm256_loadu_ps(poses.transZ + first);
+
+    __m128 low[9], high[9];
+    for (int r = 0; r < 9; r++)
+    {
+        low[r] = _mm256_castps256_ps128(rotation[r]);
+        high[r] = _mm256_extractf128_ps(rotation[r], 1);
+    }
+    storePoseMatrices4(out, low, _mm256_castps256_ps128(transX), _mm256_castps256_ps128(transY), _mm256_castps256_ps128(transZ));
+    storePoseMatrices4(out + 64, high, _mm256_extractf128_ps(transX, 1), _mm256_extractf128_ps(transY, 1), _mm256_extractf128_ps(transZ, 1));
+}
+#endif
+
+// Convert count poses to world matrices, the widest requested path first and scalar for the remainder
+void computePoseMatrices(const PoseArrays& poses, unsigned int count, glm::mat4* matrices, PoseKernelPath path = getBestPoseKernelPath())
+{
+    float* out = count > 0 ? &matrices[0][0][0] : nullptr;
+    unsigned int i = 0;
+#if defined(MY_POSE_KERNEL_AVX2)
+    if (path == PoseKernelPath::AVX2)
+    {
+        for (; i + 8 <= count; i += 8)
+            computePoseMatrices8(poses, i, out + i * 16);
+    }
+#endif
+#if defined(MY_POSE_KERNEL_SSE)
+    if (path == PoseKernelPath::AVX2 || path == PoseKernelPath::SSE)
+    {
+        for (; i + 4 <= count; i += 4)
+            computePoseMatrices4(poses, i, out + i * 16);
+    }
+#endif
+    for (; i < count; i++)
+    {
+        writePoseMatrix(out + i * 16, poses.transX[i], poses.transY[i], poses.transZ[i],
+            std::sin(poses.rotX[i]), std::cos(poses.rotX[i]), std::sin(poses.rotY[i]), std::cos(poses.rotY[i]),
+            std::sin(poses.rotZ[i]), std::cos(poses.rotZ[i]));
+    }
+}
+
+// Sines and cosines of count angles (sines may be the angles array itself)
+void computeSinCos(const float* angles, float* sines, float* cosines, unsigned int count, PoseKernelPath path = getBestPoseKernelPath())
+{
+    unsigned int i = 0;
+#if defined(MY_POSE_KERNEL_AVX2)
+    if (path == PoseKernelPath::AVX2)
+    {
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 s, c;
+            sinCos8(_mm256_loadu_ps(angles + i), s, c);
+            _mm256_storeu_ps(sines + i, s);
+            _mm256_storeu_ps(cosines + i, c);
+        }
+    }
+#endif
+#if defined(MY_POSE_KERNEL_SSE)
+    if (path == PoseKernelPath::AVX2 || path == PoseKernelPath::SSE)
+    {
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 s, c;
+            sinCos4(_mm_loadu_ps(angles + i), s, c);
+            _mm_storeu_ps(sines + i, s);
+            _mm_storeu_ps(cosines + i, c);
+        }
+    }
+#endif
+    for (; i < count; i++)
+    {
+        float angle = angles[i];
+        sines[i] = std::sin(angle);
+        cosines[i] = std::cos(angle);
+    }
+}
+#endif // MY_POSE_KERNEL_H
@@ -0,0 +1,311 @@
+#ifndef MY_PROFILER_H
+#define MY_PROFILER_H
+
+#include <glad/glad.h>
+
+#include <my_hud.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Frame profiler. Zones mark where frame time goes:
+//     PROFILE_CPU_ZONE("name");   CPU time to the end of the enclosing scope
+//     PROFILE_ZONE("name");       that and the GPU time of the GL commands issued in the scope
+// Build with MY_PROFILER defined to enable them, without it the macros expand to nothing and cost nothing.
+#ifdef MY_PROFILER
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_CPU_ZONE(name) CpuZone PROFILE_CONCAT(profileCpuZone, __LINE__)(name)
+#define PROFILE_ZONE(name) CpuZone PROFILE_CONCAT(profileCpuZone, __LINE__)(name); GpuZone PROFILE_CONCAT(profileGpuZone, __LINE__)(name)
+#else
+#define PROFILE_CPU_ZONE(name)
+#define PROFILE_ZONE(name)
+#endif
+
+// One finished CPU zone
+struct ProfileRecord
+{
+    const char* name;
+    uint64_t startNs;
+    uint64_t endNs;
+};
+
+// Fixed ring of the zones finished on one thread. Only that thread writes, the main thread reads at the end
+// of the frame (when the job system is idle); a reader that falls a whole ring behind loses the oldest records.
+class ProfileRing
+{
+public:
+    static const unsigned int CAPACITY = 4096;
+
+    void push(const ProfileRecord& record)
+    {
+        uint64_t count = written.load(std::memory_order_relaxed);
+        records[count % CAPACITY] = record;
+        written.store(count + 1, std::memory_order_release);
+    }
+
+    // Pass every record written since the last call to f
+    template <typename F>
+    void drain(F f)
+    {
+        uint64_t count = written.load(std::memory_order_acquire);
+        if (count - read > CAPACITY)
+            read = count - CAPACITY;
+        for (; read < count; read++)
+            f(records[read % CAPACITY]);
+    }
+
+private:
+    ProfileRecord records[CAPACITY];
+    std::atomic<uint64_t> written{ 0 };
+    uint64_t read = 0;
+};
+
+// Times of one zone, summed over a frame (CPU over every thread) and smoothed for display
+struct ZoneStats
+{
+    const char* name;
+    double cpuMs = 0.0;             // Smoothed
+    double gpuMs = 0.0;             // Smoothed, from the frame before last
+    double frameCpuMs = 0.0;        // This frame so far
+    double totalCpuMs = 0.0;        // Whole run, for the summary
+    double totalGpuMs = 0.0;
+    unsigned int cpuFrames = 0;
+    unsigned int gpuFrames = 0;
+
+    // Two GL_TIME_ELAPSED queries, alternate frames use alternate ones so reading never waits on the GPU
+    unsigned int queries[2] = { 0, 0 };
+    bool queryIssued[2] = { false, false };
+};
+
+// Collects the zones of every thread each frame
+class Profiler
+{
+public:
+    static Profiler& instance()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    // Nanoseconds on the profiler's clock
+    static uint64_t now()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // Ring of the calling thread, made on its first zone
+    ProfileRing& getThreadRing()
+    {
+        thread_local ProfileRing* ring = nullptr;
+        if (!ring)
+        {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            rings.emplace_back(new ProfileRing());
+            ring = rings.back().get();
+        }
+        return *ring;
+    }
+
+    // Mark the start of a frame
+    void beginFrame()
+    {
+        frameStartNs = now();
+    }
+
+    // Gather the frame's CPU zones and the GPU times of the frame before (never waits for the GPU)
+    void endFrame()
+    {
+        {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            for (std::unique_ptr<ProfileRing>& ring : rings)
+            {
+                ring->drain([this](const ProfileRecord& record)
+                {
+                    getZone(record.name).frameCpuMs += (record.endNs - record.startNs) * 1.0e-6;
+                });
+            }
+        }
+
+        unsigned int previous = 1 - frameParity;
+        for (ZoneStats& zone : zones)
+        {
+            zone.cpuMs += (zone.frameCpuMs - zone.cpuMs) * SMOOTHING;
+            zone.totalCpuMs += zone.frameCpuMs;
+            zone.cpuFrames++;
+            zone.frameCpuMs = 0.0;
+
+            if (!zone.queryIssued[previous])
+                continue;
+            GLint available = 0;
+            glGetQueryObjectiv(zone.queries[previous], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                continue;
+            GLuint64 elapsedNs = 0;
+            glGetQueryObjectui64v(zone.queries[previous], GL_QUERY_RESULT, &elapsedNs);
+            zone.queryIssued[previous] = false;
+            zone.gpuMs += (elapsedNs * 1.0e-6 - zone.gpuMs) * SMOOTHING;
+            zone.totalGpuMs += elapsedNs * 1.0e-6;
+            zone.gpuFrames++;
+        }
+
+        double frameMs = (now() - frameStartNs) * 1.0e-6;
+        frameCpuMs += (frameMs - frameCpuMs) * SMOOTHING;
+        frameParity = previous;
+    }
+
+    // Start timing the GPU work of a zone, returns false if another GPU zone is already running (they can't nest)
+    bool beginGpuZone(const char* name)
+    {
+        if (gpuZoneActive)
+            return false;
+        ZoneStats& zone = getZone(name);
+        if (zone.queries[0] == 0)
+            glGenQueries(2, zone.queries);
+        glBeginQuery(GL_TIME_ELAPSED, zone.queries[frameParity]);
+        zone.queryIssued[frameParity] = true;
+        gpuZoneActive = true;
+        return true;
+    }
+
+    void endGpuZone()
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        gpuZoneActive = false;
+    }
+
+    const std::vector<ZoneStats>& getZones() const
+    {
+        return zones;
+    }
+
+    // Zone table (name, CPU ms, GPU ms and a bar against a 60 Hz frame) at x, y on the overlay
+    void addToHud(HudOverlay& hud, float x, float y) const
+    {
+        const float scale = 2.0f;
+        const float line = HudOverlay::getLineHeight(scale);
+        const float column = HudOverlay::getCharacterAdvance(scale);
+        const float barWidth = 160.0f;
+        const double budgetMs = 1000.0 / 60.0;
+        const glm::vec4 textColor(1.0f, 1.0f, 1.0f, 1.0f);
+
+        float height = line * (zones.size() + 2) + line;
+        hud.addRect(x - line * 0.5f, y - line * 0.5f, column * 32.0f + barWidth + line, height, glm::vec4(0.0f, 0.0f, 0.0f, 0.6f));
+        hud.addText(x, y, "ZONE            CPU MS  GPU MS", glm::vec4(0.7f, 0.9f, 1.0f, 1.0f), scale);
+        y += line;
+
+        char text[64];
+        for (const ZoneStats& zone : zones)
+        {
+            std::snprintf(text, sizeof(text), "%-14.14s %7.2f %7.2f", zone.name, zone.cpuMs, zone.gpuMs);
+            hud.addText(x, y, text, textColor, scale);
+            float barX = x + column * 32.0f;
+            hud.addRect(barX, y, barWidth, scale * 2.0f, glm::vec4(1.0f, 1.0f, 1.0f, 0.15f));
+            hud.addRect(barX, y, float(std::min(1.0, zone.cpuMs / budgetMs)) * barWidth, scale * 2.0f, glm::vec4(1.0f, 0.7f, 0.2f, 0.9f));
+            hud.addRect(barX, y + scale * 3.0f, barWidth, scale * 2.0f, glm::vec4(1.0f, 1.0f, 1.0f, 0.15f));
+            hud.addRect(barX, y + scale * 3.0f, float(std::min(1.0, zone.gpuMs / budgetMs)) * barWidth, scale * 2.0f, glm::vec4(0.3f, 0.9f, 0.4f, 0.9f));
+            y += line;
+        }
+
+        std::snprintf(text, sizeof(text), "FRAME          %7.2f         (%.0f FPS)", frameCpuMs, frameCpuMs > 0.0 ? 1000.0 / frameCpuMs : 0.0);
+        hud.addText(x, y + line * 0.5f, text, textColor, scale);
+    }
+
+    // Mean time of every zone over the run
+    void print(std::ostream& out) const
+    {
+        if (zones.empty())
+            return;
+        std::streamsize precision = out.precision();
+        out << "Profile (mean ms per frame)        CPU       GPU" << std::endl << std::fixed << std::setprecision(3);
+        for (const ZoneStats& zone : zones)
+        {
+            out << "  " << std::left << std::setw(28) << zone.name << std::right
+                << std::setw(10) << (zone.cpuFrames > 0 ? zone.totalCpuMs / zone.cpuFrames : 0.0)
+                << std::setw(10) << (zone.gpuFrames > 0 ? zone.totalGpuMs / zone.gpuFrames : 0.0) << std::endl;
+        }
+        out << std::defaultfloat << std::setprecision(precision);
+    }
+
+private:
+    static constexpr double SMOOTHING = 0.1;    // Weight of the latest frame in the displayed times
+
+    std::mutex ringsMutex;
+    std::vector<std::unique_ptr<ProfileRing>> rings;
+    std::vector<ZoneStats> zones;               // In the order they first ran
+    uint64_t frameStartNs = 0;
+    double frameCpuMs = 0.0;
+    unsigned int frameParity = 0;               // Query of each zone this frame writes
+    bool gpuZoneActive = false;
+
+    Profiler() = default;
+
+    // Stats of a zone by name, added on first use
+    ZoneStats& getZone(const char* name)
+    {
+        for (ZoneStats& zone : zones)
+        {
+            if (zone.name == name || std::strcmp(zone.name, name) == 0)
+                return zone;
+        }
+        zones.emplace_back();
+        zones.back().name = name;
+        return zones.back();
+    }
+};
+
+// CPU time of a scope, the name must outlive the profiler (a string literal)
+class CpuZone
+{
+public:
+    explicit CpuZone(const char* name)
+        : name(name), startNs(Profiler::now())
+    {
+    }
+
+    ~CpuZone()
+    {
+        Profiler::instance().getThreadRing().push({ name, startNs, Profiler::now() });
+    }
+
+    CpuZone(const CpuZone&) = delete;
+    CpuZone& operator=(const CpuZone&) = delete;
+
+private:
+    const char* name;
+    uint64_t startNs;
+};
+
+// GPU time of the GL commands issued in a scope (render thread only)
+class GpuZone
+{
+public:
+    explicit GpuZone(const char* name)
+        : active(Profiler::instance().beginGpuZone(name))
+    {
+    }
+
+    ~GpuZone()
+    {
+        if (active)
+            Profiler::instance().endGpuZone();
+    }
+
+    GpuZone(const GpuZone&) = delete;
+    GpuZone& operator=(const GpuZone&) = delete;
+
+private:
+    bool active;
+};
+#endif // MY_PROFILER_H
@@ -0,0 +1,258 @@
+#ifndef MY_REPLAY_H
+#define MY_REPLAY_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Input log of a run ("--record"), replayed with "--replay" to repeat the run exactly.
+// Layout: ReplayHeader, then one InputFrame per rendered frame (raw, little-endian on the machines we use).
+// The header holds everything that decides the scene (seed, rate, options), each frame the time it took,
+// where the camera was after input (and its field of view) and how many food drops were asked for.
+const char REPLAY_MAGIC[4] = { 'A', 'Q', 'R', 'L' };
+const uint32_t REPLAY_VERSION = 3;          // Bump when the layout changes
+
+const uint32_t REPLAY_FLAG_ORBIT_FISH = 1;
+
+struct ReplayHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t seed;              // Scene layout seed
+    uint32_t flags;
+    float simulationRate;       // Steps per second
+    uint32_t numBubbles;
+    uint32_t frameCount;        // Written when the recording is closed
+    uint32_t numFish;           // Per fish population
+};
+
+// One frame of input
+struct InputFrame
+{
+    float deltaTime = 0.0f;     // Seconds the frame advanced the simulation clock by
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    float cameraYaw = 0.0f;     // Degrees
+    float cameraPitch = 0.0f;
+    float cameraZoom = 0.0f;    // Field of view (degrees), changed by the scroll wheel
+    uint32_t foodDrops = 0;     // F presses
+};
+static_assert(sizeof(InputFrame) == 32, "InputFrame is written as is");
+
+// Writes frames to a log as they happen
+class InputRecorder
+{
+public:
+    // Start a log, returns false if the file can't be written
+    bool open(const std::string& path, const ReplayHeader& runHeader)
+    {
+        out.open(path, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            std::cout << "ERROR::REPLAY::COULD_NOT_WRITE " << path << std::endl;
+            return false;
+        }
+        header = runHeader;
+        std::memcpy(header.magic, REPLAY_MAGIC, sizeof(header.magic));
+        header.version = REPLAY_VERSION;
+        header.frameCount = 0;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        return true;
+    }
+
+    bool isOpen() const
+    {
+        return out.is_open();
+    }
+
+    void record(const InputFrame& frame)
+    {
+        out.write(reinterpret_cast<const char*>(&frame), sizeof(frame));
+        header.frameCount++;
+    }
+
+    // Finish the log with its frame count
+    void close()
+    {
+        if (!out.is_open())
+            return;
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.close();
+    }
+
+    ~InputRecorder()
+    {
+        close();
+    }
+
+private:
+    std::ofstream out;
+    ReplayHeader header;
+};
+
+// Reads a whole log back
+class InputReplay
+{
+public:
+    ReplayHeader header;
+
+    // Load a log, returns false (after printing why) if it isn't one this build can play
+    bool open(const std::string& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        {
+            std::cout << "ERROR::REPLAY::COULD_NOT_READ " << path << std::endl;
+            return false;
+        }
+        if (std::memcmp(header.magic, REPLAY_MAGIC, sizeof(header.magic)) != 0 || header.version != REPLAY_VERSION)
+        {
+            std::cout << "ERROR::REPLAY::NOT_A_REPLAY_LOG " << path << std::endl;
+            return false;
+        }
+
+        frames.resize(header.frameCount);
+        if (!in.read(reinterpret_cast<char*>(frames.data()), frames.size() * sizeof(InputFrame)))
+        {
+            std::cout << "ERROR::REPLAY::TRUNCATED_LOG " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Next frame, false once the log is used up
+    bool next(InputFrame& frame)
+    {
+        if (nextFrame >= frames.size())
+            return false;
+        frame = frames[nextFrame++];
+        return true;
+    }
+
+    unsigned int size() const
+    {
+        return static_cast<unsigned int>(frames.size());
+    }
+
+private:
+    std::vector<InputFrame> frames;
+    size_t nextFrame = 0;
+};
+
+// Scripted camera path with food drops, played at a fixed frame time so every run does the same work
+class CameraTour
+{
+public:
+    // Names of the built in tours
+    static const char* getNames()
+    {
+        return "orbit, glass, feeding";
+    }
+
+    // Build a built in tour by name, seen with a field of view of zoom degrees, returns false if there is none
+    bool load(const std::string& name, float height, float zoom)
+    {
+        this->zoom = zoom;
+        keys.clear();
+        feedTimes.clear();
+        if (name == "orbit")
+        {
+            // Once around the tank looking in, 40 seconds
+            for (int i = 0; i <= 40; i++)
+            {
+                float angle = glm::radians(90.0f + 9.0f * i);
+                addKey(float(i), glm::vec3(9.5f * std::cos(angle), height, 9.5f * std::sin(angle)), glm::degrees(angle) + 180.0f, -5.0f);
+            }
+        }
+        else if (name == "glass")
+        {
+            // Up to the glass, look around the tank, then step back, 20 seconds
+            addKey(0.0f, glm::vec3(0.0f, height, 9.0f), -90.0f, 0.0f);
+            addKey(4.0f, glm::vec3(0.0f, height, 8.0f), -90.0f, -10.0f);
+            addKey(8.0f, glm::vec3(0.0f, height, 8.0f), -120.0f, -15.0f);
+            addKey(12.0f, glm::vec3(0.0f, height, 8.0f), -60.0f, -15.0f);
+            addKey(16.0f, glm::vec3(0.0f, height, 8.0f), -90.0f, -25.0f);
+            addKey(20.0f, glm::vec3(0.0f, height, 9.0f), -90.0f, 0.0f);
+        }
+        else if (name == "feeding")
+        {
+            // Watch the drop corner while food goes in four times a second, 20 seconds
+            addKey(0.0f, glm::vec3(6.0f, height, 6.0f), -135.0f, -10.0f);
+            addKey(20.0f, glm::vec3(6.0f, height, 6.0f), -135.0f, -10.0f);
+            for (int i = 1; i <= 80; i++)
+                feedTimes.push_back(0.25f * i);
+        }
+        else
+            return false;
+        return true;
+    }
+
+    float getDuration() const
+    {
+        return keys.empty() ? 0.0f : keys.back().time;
+    }
+
+    // Input of the frame ending at time, frameSeconds after the last one (a Catmull-Rom spline through the keys)
+    InputFrame getFrame(float time, float frameSeconds) const
+    {
+        InputFrame frame;
+        frame.deltaTime = frameSeconds;
+
+        unsigned int last = static_cast<unsigned int>(keys.size()) - 1;
+        unsigned int next = 1;
+        while (next < last && keys[next].time < time)
+            next++;
+        const TourKey& k0 = keys[next > 1 ? next - 2 : 0];
+        const TourKey& k1 = keys[next - 1];
+        const TourKey& k2 = keys[next];
+        const TourKey& k3 = keys[std::min(next + 1, last)];
+        float t = glm::clamp((time - k1.time) / std::max(1e-6f, k2.time - k1.time), 0.0f, 1.0f);
+        frame.cameraPosition = catmullRom(k0.position, k1.position, k2.position, k3.position, t);
+        frame.cameraYaw = catmullRom(k0.yaw, k1.yaw, k2.yaw, k3.yaw, t);
+        frame.cameraPitch = catmullRom(k0.pitch, k1.pitch, k2.pitch, k3.pitch, t);
+        frame.cameraZoom = zoom;
+
+        // Drops land on the frame nearest their time, exactly once whatever the rounding
+        long frameIndex = std::lround(time / frameSeconds);
+        for (float feedTime : feedTimes)
+        {
+            if (std::lround(feedTime / frameSeconds) == frameIndex)
+                frame.foodDrops++;
+        }
+        return frame;
+    }
+
+private:
+    struct TourKey
+    {
+        float time;
+        glm::vec3 position;
+        float yaw;
+        float pitch;
+    };
+
+    std::vector<TourKey> keys;
+    std::vector<float> feedTimes;
+    float zoom = 45.0f;
+
+    void addKey(float time, const glm::vec3& position, float yaw, float pitch)
+    {
+        keys.push_back({ time, position, yaw, pitch });
+    }
+
+    // Point t of the way from p1 to p2, passing through the keys without stopping at them
+    template <typename T>
+    static T catmullRom(const T& p0, const T& p1, const T& p2, const T& p3, float t)
+    {
+        float t2 = t * t, t3 = t2 * t;
+        return 0.5f * ((2.0f * p1) + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+    }
+};
+#endif // MY_REPLAY_H
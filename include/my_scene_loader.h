@@ -0,0 +1,108 @@
+#ifndef MY_SCENE_LOADER_H
+#define MY_SCENE_LOADER_H
+
+#include <my_model.h>
+#include <my_thread_pool.h>
+#include <my_trace.h>
+
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Loads all the scene's models at once: every file is imported concurrently on a thread pool
+// (one Assimp importer per task), then a single pass on the GL thread creates the VAOs/VBOs/EBOs.
+class SceneLoader
+{
+public:
+    // Queue a model file to load
+    void add(const std::string& path)
+    {
+        ModelLoad load;
+        load.path = path;
+        loads.push_back(load);
+    }
+
+    // Import everything in parallel, then upload on the calling (GL) thread and print timings
+    void load(unsigned int numThreads = ThreadPool::defaultThreadCount() + 1)
+    {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+        // CPU-side import
+        {
+            TraceSpan span("model", "import models");
+            ThreadPool pool(numThreads);
+            std::vector<std::future<void>> imports;
+            for (ModelLoad& load : loads)
+            {
+                ModelLoad* task = &load;
+                imports.push_back(pool.submit([task]
+                {
+                    StartupTrace::instance().nameThread("model import");
+                    TraceSpan span("model", "load geometry", task->path);
+                    std::chrono::high_resolution_clock::time_point importStart = std::chrono::high_resolution_clock::now();
+                    task->loaded = Model::loadGeometry(task->path, task->geometry, &task->fromCache);
+                    task->importMs = elapsedMs(importStart);
+                }));
+            }
+            for (std::future<void>& import : imports)
+                import.get();
+        }
+        double importMs = elapsedMs(start);
+
+        // GL objects
+        for (ModelLoad& load : loads)
+        {
+            TraceSpan span("model", "upload", load.path);
+            std::chrono::high_resolution_clock::time_point uploadStart = std::chrono::high_resolution_clock::now();
+            if (load.loaded)
+                models.emplace(load.path, Model(load.geometry));
+            load.uploadMs = elapsedMs(uploadStart);
+        }
+        double totalMs = elapsedMs(start);
+
+        // Report
+        for (const ModelLoad& load : loads)
+        {
+            std::cout << "  " << load.path << ": import " << load.importMs << " ms ("
+                << (!load.loaded ? "failed" : (load.fromCache ? "cache" : "assimp")) << "), upload " << load.uploadMs << " ms" << std::endl;
+        }
+        std::cout << "Loaded " << loads.size() << " models in " << totalMs << " ms (import " << importMs
+            << " ms on " << numThreads << " threads, upload " << totalMs - importMs << " ms)" << std::endl;
+    }
+
+    // Get a loaded model (a cheap copy, mesh data is shared)
+    Model getModel(const std::string& path) const
+    {
+        std::unordered_map<std::string, Model>::const_iterator it = models.find(path);
+        if (it == models.end())
+        {
+            std::cout << "ERROR::SCENE_LOADER::MODEL_NOT_LOADED: " << path << std::endl;
+            std::vector<MeshGeometry> empty;
+            return Model(empty);
+        }
+        return it->second;
+    }
+
+private:
+    struct ModelLoad
+    {
+        std::string path;
+        std::vector<MeshGeometry> geometry;
+        bool loaded = false;
+        bool fromCache = false;
+        double importMs = 0.0;
+        double uploadMs = 0.0;
+    };
+
+    std::vector<ModelLoad> loads;
+    std::unordered_map<std::string, Model> models;
+
+    static double elapsedMs(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+};
+#endif // MY_SCENE_LOADER_H
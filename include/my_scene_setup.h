@@ -0,0 +1,92 @@
+#ifndef MY_SCENE_SETUP_H
+#define MY_SCENE_SETUP_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <my_model.h>
+
+#include <vector>
+
+// 3D model names
+#define MODEL_FLOOR "models/floor.obj"
+#define MODEL_WALLS "models/walls.obj"
+#define MODEL_ROOF "models/roof.obj"
+#define MODEL_FISH_TANK "models/fish_tank.obj"
+#define MODEL_ROOF_LAMP "models/roof_lamp.obj"
+#define MODEL_KELP "models/kelp.obj"
+#define MODEL_JELLYFISH "models/jellyfish.obj"
+#define MODEL_JELLYFISH2 "models/jellyfish2.obj"
+#define MODEL_DIRT_FLOOR "models/dirt_floor.obj"
+#define MODEL_ROCK "models/rock.obj"
+#define MODEL_FISH1 "models/fish1.obj"
+#define MODEL_FISH2 "models/fish2.obj"
+#define MODEL_VOLCANO "models/volcano.obj"
+#define MODEL_SHARK "models/shark.obj"
+#define MODEL_PAINTING "models/painting1.obj"
+#define MODEL_TABLES "models/tables.obj"
+
+// Function to init models (copies only the per-instance records, mesh data is shared)
+Model initModel(const Model& _model, const float _tX, const float _tY, 
+    const float _tZ, const float _rX, const float _rY, const float _rZ)
+{
+    Model model = _model;
+    for (unsigned int i = 0; i < static_cast<unsigned int>(model.meshes.size()); i++)
+    {
+        // Base mesh, rotated and translated
+        if (i == 0)
+        {
+            // Set 6 DoF pose params
+            model.meshes[i].mesh6DoF[tX] = _tX; model.meshes[i].mesh6DoF[tY] = _tY; model.meshes[i].mesh6DoF[tZ] = _tZ;
+            model.meshes[i].mesh6DoF[rX] = _rX; model.meshes[i].mesh6DoF[rY] = _rY; model.meshes[i].mesh6DoF[rZ] = _rZ;
+
+            // Rotations in radians, X, Y, then Z
+            glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), _rX, glm::vec3(1.0f, 0.0f, 0.0f));
+            rotation = glm::rotate(rotation, _rY, glm::vec3(0.0f, 1.0f, 0.0f));
+            rotation = glm::rotate(rotation, _rZ, glm::vec3(0.0f, 0.0f, 1.0f));
+
+            // Translation
+            glm::mat4 translation = glm::translate(glm::mat4(1.0f), glm::vec3(tX, tY, tZ));
+            model.meshes[i].meshMatrix = rotation * translation;
+        }
+        // Rest of meshes lower in hierarchy, identity for now
+        else
+            model.meshes[i].meshMatrix = glm::mat4(1);
+
+        model.meshes[i].updateModelMatrix();
+    }
+    return model;
+}
+
+// Wall constrains function
+glm::vec4 getWallConstraints(std::vector<glm::vec3> modelVertices)
+{
+    float xMin{}, xMax{}, zMin{}, zMax{};
+    for (int i = 0; i < (int)modelVertices.size(); i++)
+    {
+        // If first loop, just set
+        if (i == 0)
+        {
+            xMin = xMax = modelVertices[i].x;
+            zMin = zMax = modelVertices[i].z;
+            continue;
+        }
+
+        // Else compare to find constraints
+        if (modelVertices[i].x < xMin)
+            xMin = modelVertices[i].x;
+        if (modelVertices[i].x > xMax)
+            xMax = modelVertices[i].x;
+        if (modelVertices[i].z < zMin)
+            zMin = modelVertices[i].z;
+        if (modelVertices[i].z > zMax)
+            zMax = modelVertices[i].z;
+    }
+
+    // Adjust slightly so not exactly "in wall"
+    xMin += 0.25f; xMax -= 0.25f;
+    zMin += 0.25f; zMax -= 0.25f;
+
+    return glm::vec4(xMin, xMax, zMin, zMax);
+}
+#endif // MY_SCENE_SETUP_H
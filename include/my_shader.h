@@ -4,68 +4,59 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <my_gl_counters.h>
+#include <my_trace.h>
+
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
+#include <vector>
 
-class Shader
+// Typed handle to a uniform location resolved once at link time.
+// Keep it around and reuse it, setting it does no string work or location lookup.
+// Like the Shader::set* functions, the owning program must be in use.
+template <typename T>
+class Uniform
 {
 public:
-    unsigned int ID;
+    GLint location = -1;
 
-    Shader(const char* vertexPath, const char* fragmentPath)
+    Uniform() = default;
+    explicit Uniform(GLint location) : location(location) {}
+
+    // Check if the uniform is active in the program
+    bool isValid() const
     {
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
+        return location >= 0;
+    }
 
-        // Ensure ifstream objects can throw exceptions
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try
-        {
-            // Open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-
-            // Read file's buffer contents into streams
-            std::stringstream vShaderStream, fShaderStream;
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-
-            // Close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-
-            // Convert stream to string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
-        }
-        catch (std::ifstream::failure& e)
-        {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
-        }
+    void set(const T& value) const;
+};
 
-        // Convert string to C-string
-        const char* vShaderCode = vertexCode.c_str();
-        const char* fShaderCode = fragmentCode.c_str();
+template <> inline void Uniform<bool>::set(const bool& value) const { GLCounters::uniform(glUniform1i, location, (int)value); }
+template <> inline void Uniform<int>::set(const int& value) const { GLCounters::uniform(glUniform1i, location, value); }
+template <> inline void Uniform<float>::set(const float& value) const { GLCounters::uniform(glUniform1f, location, value); }
+template <> inline void Uniform<glm::vec2>::set(const glm::vec2& value) const { GLCounters::uniform(glUniform2fv, location, 1, &value[0]); }
+template <> inline void Uniform<glm::vec3>::set(const glm::vec3& value) const { GLCounters::uniform(glUniform3fv, location, 1, &value[0]); }
+template <> inline void Uniform<glm::vec4>::set(const glm::vec4& value) const { GLCounters::uniform(glUniform4fv, location, 1, &value[0]); }
+template <> inline void Uniform<glm::mat2>::set(const glm::mat2& value) const { GLCounters::uniform(glUniformMatrix2fv, location, 1, GL_FALSE, &value[0][0]); }
+template <> inline void Uniform<glm::mat3>::set(const glm::mat3& value) const { GLCounters::uniform(glUniformMatrix3fv, location, 1, GL_FALSE, &value[0][0]); }
+template <> inline void Uniform<glm::mat4>::set(const glm::mat4& value) const { GLCounters::uniform(glUniformMatrix4fv, location, 1, GL_FALSE, &value[0][0]); }
 
-        // Compile shaders
-        unsigned int vertex, fragment;
+class Shader
+{
+public:
+    unsigned int ID;
 
-        // Vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "Vertex");
+    Shader(const char* vertexPath, const char* fragmentPath)
+    {
+        TraceSpan span("shader", "compile", vertexPath);
 
-        // Fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "Fragment");
+        // Compile shaders
+        unsigned int vertex = compileShader(GL_VERTEX_SHADER, readShaderFile(vertexPath), "Vertex");
+        unsigned int fragment = compileShader(GL_FRAGMENT_SHADER, readShaderFile(fragmentPath), "Fragment");
 
         // Shader Program
         ID = glCreateProgram();
@@ -77,75 +68,191 @@ public:
         // Delete the shaders as they're linked into our program now and no longer necessary
         glDeleteShader(vertex);
         glDeleteShader(fragment);
+
+        // Cache all uniform locations so the set functions don't query GL
+        reflectUniforms();
+    }
+
+    // Vertex-only program for transform feedback, capturing the given outputs interleaved into one buffer
+    Shader(const char* vertexPath, const std::vector<const char*>& feedbackVaryings)
+    {
+        TraceSpan span("shader", "compile", vertexPath);
+
+        unsigned int vertex = compileShader(GL_VERTEX_SHADER, readShaderFile(vertexPath), "Vertex");
+
+        // Varyings have to be named before linking
+        ID = glCreateProgram();
+        glAttachShader(ID, vertex);
+        glTransformFeedbackVaryings(ID, static_cast<GLsizei>(feedbackVaryings.size()), feedbackVaryings.data(), GL_INTERLEAVED_ATTRIBS);
+        glLinkProgram(ID);
+        checkCompileErrors(ID, "Program");
+        glDeleteShader(vertex);
+
+        reflectUniforms();
+    }
+
+    // Attach a uniform block to a binding point (ignored if the program doesn't use the block)
+    void bindUniformBlock(const char* blockName, GLuint bindingPoint) const
+    {
+        GLuint blockIndex = glGetUniformBlockIndex(ID, blockName);
+        if (blockIndex != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, blockIndex, bindingPoint);
+    }
+
+    // Get a typed handle to a uniform (location is -1 if the uniform isn't active)
+    template <typename T>
+    Uniform<T> uniform(const std::string& name) const
+    {
+        return Uniform<T>(getUniformLocation(name));
+    }
+
+    // Look up a cached uniform location
+    GLint getUniformLocation(const std::string& name) const
+    {
+        std::unordered_map<std::string, GLint>::const_iterator it = uniformLocations.find(name);
+        if (it == uniformLocations.end())
+            return -1;
+        return it->second;
     }
 
     // Activates the shader
     void use()
     {
-        glUseProgram(ID);
+        GLCounters::useProgram(ID);
     }
 
     // Uniform functions
     void setBool(const std::string& name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        GLCounters::uniform(glUniform1i, getUniformLocation(name), (int)value);
     }
 
     void setInt(const std::string& name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        GLCounters::uniform(glUniform1i, getUniformLocation(name), value);
     }
 
     void setFloat(const std::string& name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        GLCounters::uniform(glUniform1f, getUniformLocation(name), value);
     }
 
     void setVec2(const std::string& name, const glm::vec2& value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        GLCounters::uniform(glUniform2fv, getUniformLocation(name), 1, &value[0]);
     }
 
     void setVec2(const std::string& name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        GLCounters::uniform(glUniform2f, getUniformLocation(name), x, y);
     }
 
     void setVec3(const std::string& name, const glm::vec3& value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        GLCounters::uniform(glUniform3fv, getUniformLocation(name), 1, &value[0]);
     }
 
     void setVec3(const std::string& name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        GLCounters::uniform(glUniform3f, getUniformLocation(name), x, y, z);
     }
 
     void setVec4(const std::string& name, const glm::vec4& value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        GLCounters::uniform(glUniform4fv, getUniformLocation(name), 1, &value[0]);
     }
     void setVec4(const std::string& name, float x, float y, float z, float w)
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        GLCounters::uniform(glUniform4f, getUniformLocation(name), x, y, z, w);
     }
 
     void setMat2(const std::string& name, const glm::mat2& mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        GLCounters::uniform(glUniformMatrix2fv, getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
 
     void setMat3(const std::string& name, const glm::mat3& mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        GLCounters::uniform(glUniformMatrix3fv, getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
 
     void setMat4(const std::string& name, const glm::mat4& mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        GLCounters::uniform(glUniformMatrix4fv, getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
 
 private:
+    std::unordered_map<std::string, GLint> uniformLocations;
+
+    // Read a shader source file
+    static std::string readShaderFile(const char* path)
+    {
+        // Ensure ifstream objects can throw exceptions
+        std::ifstream shaderFile;
+        shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+        try
+        {
+            shaderFile.open(path);
+            std::stringstream shaderStream;
+            shaderStream << shaderFile.rdbuf();
+            shaderFile.close();
+            return shaderStream.str();
+        }
+        catch (std::ifstream::failure& e)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path << " " << e.what() << std::endl;
+        }
+        return std::string();
+    }
+
+    // Compile one stage
+    unsigned int compileShader(GLenum stage, const std::string& code, const std::string& type)
+    {
+        const char* source = code.c_str();
+        unsigned int shader = glCreateShader(stage);
+        glShaderSource(shader, 1, &source, NULL);
+        glCompileShader(shader);
+        checkCompileErrors(shader, type);
+        return shader;
+    }
+
+    // Reads all active uniforms of the linked program into the location cache
+    void reflectUniforms()
+    {
+        GLint numUniforms = 0, maxNameLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &numUniforms);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+        std::string name(maxNameLength, '\0');
+        for (GLint i = 0; i < numUniforms; i++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(ID, (GLuint)i, maxNameLength, &length, &size, &type, &name[0]);
+            std::string uniformName = name.substr(0, length);
+
+            // Uniform block members have no location
+            GLint location = glGetUniformLocation(ID, uniformName.c_str());
+            if (location < 0)
+                continue;
+            uniformLocations[uniformName] = location;
+
+            // Arrays are reported as "name[0]", also register the bare name and the other elements
+            std::string::size_type bracket = uniformName.rfind("[0]");
+            if (bracket != std::string::npos && bracket + 3 == uniformName.size())
+            {
+                std::string baseName = uniformName.substr(0, bracket);
+                uniformLocations[baseName] = location;
+                for (GLint j = 1; j < size; j++)
+                {
+                    std::string elementName = baseName + "[" + std::to_string(j) + "]";
+                    uniformLocations[elementName] = glGetUniformLocation(ID, elementName.c_str());
+                }
+            }
+        }
+    }
+
     // Checks shader compilation/linking errors
     void checkCompileErrors(GLuint shader, std::string type)
     {
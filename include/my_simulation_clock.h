@@ -0,0 +1,102 @@
+#ifndef MY_SIMULATION_CLOCK_H
+#define MY_SIMULATION_CLOCK_H
+
+#include <algorithm>
+#include <cmath>
+
+// Fixed-rate simulation clock. Frame time is accumulated and spent in whole steps, so the simulation
+// advances the same way at any frame rate; drawing interpolates between the last two steps (alpha).
+//
+//     clock.addFrameTime(deltaTime);
+//     while (clock.step())
+//         simulate(clock.getTime(), clock.getStepSeconds());
+//     draw(clock.getRenderTime(), clock.getAlpha());
+class SimulationClock
+{
+public:
+    // Constructor (steps per second, and the most steps a single frame may run before time is dropped)
+    SimulationClock(double stepsPerSecond = 60.0, unsigned int maxStepsPerFrame = 8)
+        : maxStepsPerFrame(std::max(1u, maxStepsPerFrame))
+    {
+        setRate(stepsPerSecond);
+    }
+
+    // Change the simulation rate (behaviour doesn't change, only its resolution)
+    void setRate(double stepsPerSecond)
+    {
+        stepSeconds = 1.0 / std::max(1.0, stepsPerSecond);
+    }
+
+    // Start a frame, adding the real time since the last one
+    void addFrameTime(double frameSeconds)
+    {
+        accumulator += std::max(0.0, frameSeconds);
+        stepsThisFrame = 0;
+    }
+
+    // Take one step if enough time has built up, returns false when the frame is caught up
+    bool step()
+    {
+        if (accumulator < stepSeconds)
+            return false;
+
+        // Too far behind (a stall or a slow machine): drop the backlog instead of spiralling
+        if (stepsThisFrame == maxStepsPerFrame)
+        {
+            double dropped = std::floor(accumulator / stepSeconds) * stepSeconds;
+            droppedSeconds += dropped;
+            accumulator -= dropped;
+            return false;
+        }
+
+        accumulator -= stepSeconds;
+        time += stepSeconds;
+        stepCount++;
+        stepsThisFrame++;
+        return true;
+    }
+
+    // Simulation time after the last step (seconds)
+    float getTime() const
+    {
+        return static_cast<float>(time);
+    }
+
+    float getStepSeconds() const
+    {
+        return static_cast<float>(stepSeconds);
+    }
+
+    // How far the frame is between the previous step and the last one (0 to 1)
+    float getAlpha() const
+    {
+        return static_cast<float>(std::min(1.0, accumulator / stepSeconds));
+    }
+
+    // Time the frame shows, matching the interpolated state (one step behind the simulation at most)
+    float getRenderTime() const
+    {
+        return static_cast<float>(time - stepSeconds + getAlpha() * stepSeconds);
+    }
+
+    unsigned long long getStepCount() const
+    {
+        return stepCount;
+    }
+
+    // Real time discarded because frames fell too far behind
+    double getDroppedSeconds() const
+    {
+        return droppedSeconds;
+    }
+
+private:
+    double stepSeconds = 1.0 / 60.0;
+    double accumulator = 0.0;
+    double time = 0.0;
+    double droppedSeconds = 0.0;
+    unsigned long long stepCount = 0;
+    unsigned int maxStepsPerFrame;
+    unsigned int stepsThisFrame = 0;
+};
+#endif // MY_SIMULATION_CLOCK_H
@@ -0,0 +1,69 @@
+#ifndef MY_SWIM_BATCH_H
+#define MY_SWIM_BATCH_H
+
+#include <glad/glad.h>
+
+#include <my_mesh.h>
+#include <my_model.h>
+#include <my_shader.h>
+
+#include <vector>
+
+// Per-instance constants of a fish swimming a circular orbit (vertex attribute location 7)
+struct SwimInstance
+{
+    float radius;
+    float phase;
+    float height;
+    float angularSpeed;
+};
+
+// Fish population posed entirely in the vertex shader from the time uniform.
+// The instance constants are uploaded once, so drawing costs no CPU work per fish.
+class SwimBatch
+{
+public:
+    // Constructor (expects the prototype model and the orbit of every fish)
+    SwimBatch(Model& prototype, const std::vector<SwimInstance>& instances)
+        : prototype(&prototype)
+        , instanceCount(static_cast<unsigned int>(instances.size()))
+    {
+        glGenBuffers(1, &instanceVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(SwimInstance), instances.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        for (Mesh& mesh : prototype.meshes)
+            mesh.setupAttribute(instanceVBO, 7, 4, sizeof(SwimInstance), 0, 1);
+    }
+
+    // Draw every fish, one call per mesh
+    void draw(Shader& shader)
+    {
+        // Resolve the uniform handles once per program
+        if (shader.ID != shaderID)
+        {
+            useSwimAnimationUniform = shader.uniform<bool>("useSwimAnimation");
+            swimSegmentPhaseUniform = shader.uniform<float>("swimSegmentPhase");
+            shaderID = shader.ID;
+        }
+
+        useSwimAnimationUniform.set(true);
+        for (unsigned int j = 0; j < static_cast<unsigned int>(prototype->meshes.size()); j++)
+        {
+            // Each segment wags with its own phase
+            swimSegmentPhaseUniform.set(j * 5.0f);
+            prototype->meshes[j].drawInstanced(shader, instanceCount);
+        }
+        useSwimAnimationUniform.set(false);
+    }
+
+private:
+    Model* prototype;
+    unsigned int instanceCount;
+    unsigned int instanceVBO;
+    unsigned int shaderID = 0;
+    Uniform<bool> useSwimAnimationUniform;
+    Uniform<float> swimSegmentPhaseUniform;
+};
+#endif // MY_SWIM_BATCH_H
@@ -0,0 +1,410 @@
+#ifndef MY_TEXTURE_REGISTRY_H
+#define MY_TEXTURE_REGISTRY_H
+
+#include <glad/glad.h>
+
+#include <stb_image.h>
+
+#include <my_gl_counters.h>
+#include <my_thread_pool.h>
+#include <my_trace.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct TextureResource;
+
+// Ref-counted texture handle, the GL texture is deleted with the last handle
+using TextureHandle = std::shared_ptr<TextureResource>;
+
+// GL texture shared by every material slot that references the same file or the same pixels.
+// Handles are returned before the texture is decoded, id stays 0 until the GL thread finalizes it.
+struct TextureResource
+{
+    unsigned int id = 0;
+    bool ready = false;             // Uploaded (or failed), id is final
+    std::string path;               // Path it was first loaded from
+    uint64_t contentHash = 0;       // Hash of the encoded file bytes
+    size_t fileSize = 0;
+    int width = 0, height = 0, numChannels = 0;
+    size_t vramBytes = 0;           // Estimate, including mipmaps
+    double decodeMs = 0.0;          // Time spent decoding on a worker
+    TextureHandle source;           // Texture with identical bytes this one shares its GL texture with
+};
+
+// What deduplication saved
+struct TextureStats
+{
+    unsigned int requests = 0;      // Material slots that asked for a texture
+    unsigned int decoded = 0;       // Textures actually decoded and uploaded
+    unsigned int pathHits = 0;      // Requests served by path
+    unsigned int contentHits = 0;   // Requests served by a different file with identical bytes
+    size_t vramBytes = 0;
+    size_t vramBytesSaved = 0;
+    double decodeMs = 0.0;
+    double decodeMsSaved = 0.0;
+};
+
+// 64-bit FNV-1a hash
+uint64_t hashBytes(const unsigned char* data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Upload pixels to a new GL texture with mipmaps (pixels is an offset if a pixel unpack buffer is bound)
+unsigned int createTexture(const void* pixels, int width, int height, int numChannels)
+{
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+
+    GLenum format = GL_RGB;
+    if (numChannels == 1)
+        format = GL_RED;
+    else if (numChannels == 3)
+        format = GL_RGB;
+    else if (numChannels == 4)
+        format = GL_RGBA;
+
+    // stb rows are tightly packed
+    // (trace spans cover the CPU side of the calls, the driver may finish the work later)
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    GLCounters::bindTexture(GL_TEXTURE_2D, textureID);
+    {
+        TraceSpan span("texture", "glTexImage2D", [&]() { return std::to_string(width) + "x" + std::to_string(height); });
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, pixels);
+    }
+    {
+        TraceSpan span("texture", "glGenerateMipmap");
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    return textureID;
+}
+
+// Process-wide texture registry keyed by path and by content hash.
+// Files are read, hashed and decoded on a worker pool; the GL thread only streams the
+// decoded pixels through a pixel buffer object into the texture in finalizeUploads().
+class TextureRegistry
+{
+public:
+    static TextureRegistry& instance()
+    {
+        static TextureRegistry registry;
+        return registry;
+    }
+
+    // Get a handle to the texture at path without waiting for it to load.
+    // Reuses the texture if the path is known, otherwise queues it for decoding.
+    TextureHandle acquire(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        stats.requests++;
+
+        // Same path
+        std::unordered_map<std::string, std::weak_ptr<TextureResource>>::iterator pathIt = byPath.find(path);
+        if (pathIt != byPath.end())
+        {
+            if (TextureHandle texture = pathIt->second.lock())
+            {
+                // Savings of a texture that's still loading are counted when it finishes
+                stats.pathHits++;
+                if (texture->ready)
+                    recordSavings(*texture);
+                else
+                    pendingPathHits[texture.get()]++;
+                return texture;
+            }
+        }
+
+        // New path, decode on a worker
+        TextureHandle texture(new TextureResource(), [](TextureResource* resource)
+        {
+            if (!resource->source && contextAlive())
+                glDeleteTextures(1, &resource->id);
+            delete resource;
+        });
+        texture->path = path;
+        byPath[path] = texture;
+        pending++;
+        workers.submit([this, texture] { decode(texture); });
+        return texture;
+    }
+
+    // Upload decoded textures, call from the GL thread (returns how many were finalized)
+    unsigned int finalizeUploads()
+    {
+        std::deque<DecodedTexture> decoded;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            decoded.swap(completed);
+        }
+
+        unsigned int finalized = 0;
+        for (DecodedTexture& result : decoded)
+        {
+            if (result.source)
+                waitingForSource.push_back(std::move(result));
+            else
+            {
+                upload(result);
+                finalized++;
+            }
+        }
+
+        // Content duplicates can only share the GL texture once its source is uploaded
+        for (std::deque<DecodedTexture>::iterator it = waitingForSource.begin(); it != waitingForSource.end();)
+        {
+            if (!it->source->ready)
+            {
+                ++it;
+                continue;
+            }
+
+            TextureResource& texture = *it->texture;
+            const TextureResource& source = *it->source;
+            texture.id = source.id;
+            texture.width = source.width;
+            texture.height = source.height;
+            texture.numChannels = source.numChannels;
+            texture.source = it->source;
+            markReady(texture, false);
+            finalized++;
+            it = waitingForSource.erase(it);
+        }
+        return finalized;
+    }
+
+    // Block until every queued texture has been uploaded, call from the GL thread
+    void waitForUploads()
+    {
+        TraceSpan span("texture", "wait for textures");
+        for (;;)
+        {
+            finalizeUploads();
+
+            std::unique_lock<std::mutex> lock(registryMutex);
+            if (pending == 0)
+                return;
+            registryCondition.wait(lock, [this] { return !completed.empty(); });
+        }
+    }
+
+    // Stop deleting GL textures (call before the context is destroyed)
+    void releaseContext()
+    {
+        contextAlive() = false;
+    }
+
+    TextureStats getStats()
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        return stats;
+    }
+
+    // Print what dedup saved
+    void printReport()
+    {
+        TextureStats report = getStats();
+        std::cout << "Textures: " << report.requests << " requests, " << report.decoded << " decoded, "
+            << report.pathHits << " path hits, " << report.contentHits << " content hits" << std::endl;
+        std::cout << "Textures: " << report.vramBytes / (1024.0 * 1024.0) << " MB VRAM (saved " << report.vramBytesSaved / (1024.0 * 1024.0)
+            << " MB), " << report.decodeMs << " ms decode (saved " << report.decodeMsSaved << " ms)" << std::endl;
+    }
+
+private:
+    // Result of a worker, either decoded pixels or the texture with identical bytes
+    struct DecodedTexture
+    {
+        TextureHandle texture;
+        TextureHandle source;
+        unsigned char* pixels = nullptr;    // Owned by stb
+    };
+
+    std::unordered_map<std::string, std::weak_ptr<TextureResource>> byPath;
+    std::unordered_map<uint64_t, std::weak_ptr<TextureResource>> byHash;
+    std::unordered_map<const TextureResource*, unsigned int> pendingPathHits;
+    std::deque<DecodedTexture> completed;           // Filled by workers
+    std::deque<DecodedTexture> waitingForSource;    // GL thread only
+    unsigned int pending = 0;
+    TextureStats stats;
+    std::mutex registryMutex;
+    std::condition_variable registryCondition;
+    ThreadPool workers;     // Declared last so workers stop before the rest is destroyed
+
+    TextureRegistry() = default;
+
+    // GL textures are only deleted while the context exists
+    static bool& contextAlive()
+    {
+        static bool alive = true;
+        return alive;
+    }
+
+    // Count what one request served from an existing texture saved
+    void recordSavings(const TextureResource& texture)
+    {
+        stats.vramBytesSaved += texture.vramBytes;
+        stats.decodeMsSaved += texture.decodeMs;
+    }
+
+    // Worker: read, hash and decode a texture file
+    void decode(TextureHandle texture)
+    {
+        StartupTrace::instance().nameThread("texture decode");
+        TraceSpan span("texture", "load", texture->path);
+        DecodedTexture result;
+        result.texture = texture;
+
+        // Read the encoded file
+        std::vector<unsigned char> fileBytes;
+        {
+            TraceSpan readSpan("texture", "read and hash", texture->path);
+            std::ifstream file(texture->path, std::ios::binary);
+            if (file)
+                fileBytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+        uint64_t contentHash = hashBytes(fileBytes.data(), fileBytes.size());
+
+        // Different path, same bytes: share the texture that claimed this hash first
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            texture->contentHash = contentHash;
+            texture->fileSize = fileBytes.size();
+            if (!fileBytes.empty())
+            {
+                std::unordered_map<uint64_t, std::weak_ptr<TextureResource>>::iterator hashIt = byHash.find(contentHash);
+                TextureHandle source = hashIt != byHash.end() ? hashIt->second.lock() : TextureHandle();
+                if (source && source->fileSize == fileBytes.size())
+                    result.source = source;
+                else
+                    byHash[contentHash] = texture;
+            }
+        }
+
+        if (!result.source)
+        {
+            TraceSpan decodeSpan("texture", "stbi_load", texture->path);
+            std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+            // Nothing else flips, so the global stb setting is safe to use from the workers
+            stbi_set_flip_vertically_on_load(false);
+            int width = 0, height = 0, numChannels = 0;
+            if (!fileBytes.empty())
+                result.pixels = stbi_load_from_memory(fileBytes.data(), static_cast<int>(fileBytes.size()), &width, &height, &numChannels, 0);
+            if (result.pixels)
+            {
+                texture->width = width;
+                texture->height = height;
+                texture->numChannels = numChannels;
+
+                // Full chain of mipmaps adds a third
+                texture->vramBytes = size_t(width) * size_t(height) * size_t(numChannels) * 4 / 3;
+            }
+            texture->decodeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            completed.push_back(std::move(result));
+        }
+        registryCondition.notify_all();
+    }
+
+    // GL thread: stream decoded pixels through a pixel buffer object into a new texture
+    void upload(DecodedTexture& result)
+    {
+        TextureResource& texture = *result.texture;
+        TraceSpan span("texture", "upload", texture.path);
+        if (result.pixels)
+        {
+            size_t size = size_t(texture.width) * size_t(texture.height) * size_t(texture.numChannels);
+
+            unsigned int PBO;
+            glGenBuffers(1, &PBO);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, PBO);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+            void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            if (mapped)
+            {
+                std::memcpy(mapped, result.pixels, size);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                texture.id = createTexture((void*)0, texture.width, texture.height, texture.numChannels);
+            }
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            glDeleteBuffers(1, &PBO);   // Storage lives on until the transfer is done
+
+            // Fall back to a direct upload if the buffer couldn't be mapped
+            if (!mapped)
+                texture.id = createTexture(result.pixels, texture.width, texture.height, texture.numChannels);
+        }
+        else
+        {
+            std::cout << "Texture failed to load at path: " << texture.path << std::endl;
+            glGenTextures(1, &texture.id);
+        }
+        stbi_image_free(result.pixels);
+        result.pixels = nullptr;
+
+        markReady(texture, true);
+    }
+
+    // GL thread: publish a finalized texture and settle its stats
+    void markReady(TextureResource& texture, bool decoded)
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        texture.ready = true;
+        pending--;
+
+        if (decoded)
+        {
+            stats.decoded++;
+            stats.vramBytes += texture.vramBytes;
+            stats.decodeMs += texture.decodeMs;
+        }
+        else
+        {
+            stats.contentHits++;
+            recordSavings(*texture.source);
+        }
+
+        // Path hits that arrived while it was loading
+        std::unordered_map<const TextureResource*, unsigned int>::iterator hitIt = pendingPathHits.find(&texture);
+        if (hitIt != pendingPathHits.end())
+        {
+            const TextureResource& served = texture.source ? *texture.source : texture;
+            for (unsigned int i = 0; i < hitIt->second; i++)
+                recordSavings(served);
+            pendingPathHits.erase(hitIt);
+        }
+    }
+};
+
+// Request a texture through the registry (returns immediately, see TextureRegistry::finalizeUploads)
+TextureHandle loadTexture(const char* texturePath)
+{
+    return TextureRegistry::instance().acquire(texturePath);
+}
+#endif // MY_TEXTURE_REGISTRY_H
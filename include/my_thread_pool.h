@@ -0,0 +1,94 @@
+#ifndef MY_THREAD_POOL_H
+#define MY_THREAD_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed-size pool of worker threads running queued tasks in FIFO order
+class ThreadPool
+{
+public:
+    // Start the workers (defaults to one per core, leaving one for the GL thread)
+    ThreadPool(unsigned int numThreads = defaultThreadCount())
+    {
+        numThreads = std::max(1u, numThreads);
+        for (unsigned int i = 0; i < numThreads; i++)
+            workers.emplace_back([this] { workerLoop(); });
+    }
+
+    // Finish queued tasks and join the workers
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            stopping = true;
+        }
+        queueCondition.notify_all();
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queue a task, the future holds its result (or exception)
+    template <typename F>
+    std::future<typename std::invoke_result<F>::type> submit(F&& task)
+    {
+        typedef typename std::invoke_result<F>::type Result;
+        std::shared_ptr<std::packaged_task<Result()>> packagedTask = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> result = packagedTask->get_future();
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            tasks.emplace_back([packagedTask] { (*packagedTask)(); });
+        }
+        queueCondition.notify_one();
+        return result;
+    }
+
+    // Number of worker threads
+    unsigned int size() const
+    {
+        return static_cast<unsigned int>(workers.size());
+    }
+
+    static unsigned int defaultThreadCount()
+    {
+        unsigned int cores = std::thread::hardware_concurrency();
+        return cores > 1 ? cores - 1 : 1;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    bool stopping = false;
+
+    // Run tasks until stopped and the queue is empty
+    void workerLoop()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueCondition.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty())
+                    return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+};
+#endif // MY_THREAD_POOL_H
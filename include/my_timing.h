@@ -0,0 +1,37 @@
+#ifndef MY_TIMING_H
+#define MY_TIMING_H
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+// Value at a percentile (0 to 100) of sorted values, nearest rank
+double getSortedPercentile(const std::vector<double>& sorted, double percentile)
+{
+    if (sorted.empty())
+        return 0.0;
+    size_t index = static_cast<size_t>(percentile / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+// Nanoseconds one call of f takes
+template <typename F>
+double timeNs(F f)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Median time of a few runs after one warm-up run (ms)
+template <typename F>
+double timeMedian(F run, int repeats)
+{
+    std::vector<double> times;
+    run();
+    for (int r = 0; r < repeats; r++)
+        times.push_back(timeNs(run) * 1.0e-6);
+    std::sort(times.begin(), times.end());
+    return getSortedPercentile(times, 50.0);
+}
+#endif // MY_TIMING_H
@@ -0,0 +1,202 @@
+#ifndef MY_TRACE_H
+#define MY_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Timeline of startup written as a Chrome trace (JSON, opens in chrome://tracing or ui.perfetto.dev),
+// one lane per thread. Off unless enabled (--trace), spans then cost a flag check and nothing is stored.
+class StartupTrace
+{
+public:
+    static StartupTrace& instance()
+    {
+        static StartupTrace trace;
+        return trace;
+    }
+
+    // Microseconds since the first call, on every thread
+    static uint64_t now()
+    {
+        static const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - origin).count());
+    }
+
+    // Start recording spans
+    void enable()
+    {
+        enabled = true;
+    }
+
+    bool isEnabled() const
+    {
+        return enabled;
+    }
+
+    // Label the calling thread's lane (the first name given sticks)
+    void nameThread(const char* name)
+    {
+        if (!enabled)
+            return;
+        std::lock_guard<std::mutex> lock(traceMutex);
+        Lane& lane = getLane();
+        if (lane.name.empty())
+            lane.name = name;
+    }
+
+    // Record a finished span on the calling thread's lane
+    void addSpan(const std::string& name, const char* category, uint64_t startUs, uint64_t endUs)
+    {
+        if (!enabled)
+            return;
+        std::lock_guard<std::mutex> lock(traceMutex);
+        events.push_back({ name, category, getLane().id, startUs, endUs - startUs });
+    }
+
+    // Record a startup phase on the calling thread that ran from startUs until now, returns now (the start of the next phase)
+    uint64_t endPhase(const char* name, uint64_t startUs)
+    {
+        uint64_t endUs = now();
+        addSpan(name, "startup", startUs, endUs);
+        return endUs;
+    }
+
+    // Write everything recorded so far and stop recording, returns false if the file can't be written
+    bool write(const std::string& path)
+    {
+        enabled = false;
+        std::lock_guard<std::mutex> lock(traceMutex);
+        std::ofstream out(path);
+        if (!out)
+        {
+            std::cout << "ERROR::TRACE::COULD_NOT_WRITE " << path << std::endl;
+            return false;
+        }
+
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Aquarium startup\"}}";
+        for (const Lane& lane : lanes)
+        {
+            out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << lane.id
+                << ",\"args\":{\"name\":\"" << escape(lane.name.empty() ? "thread " + std::to_string(lane.id) : lane.name) << "\"}}";
+            out << ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":" << lane.id
+                << ",\"args\":{\"sort_index\":" << lane.id << "}}";
+        }
+        for (const TraceEvent& event : events)
+        {
+            out << ",\n{\"name\":\"" << escape(event.name) << "\",\"cat\":\"" << event.category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                << event.lane << ",\"ts\":" << event.startUs << ",\"dur\":" << event.durationUs << "}";
+        }
+        out << "\n]}\n";
+        std::cout << "Startup trace (" << events.size() << " spans on " << lanes.size() << " threads) written to " << path << std::endl;
+        return true;
+    }
+
+private:
+    struct TraceEvent
+    {
+        std::string name;
+        const char* category;
+        unsigned int lane;
+        uint64_t startUs;
+        uint64_t durationUs;
+    };
+
+    struct Lane
+    {
+        unsigned int id;
+        std::string name;
+    };
+
+    std::atomic<bool> enabled{ false };
+    std::mutex traceMutex;
+    std::vector<TraceEvent> events;
+    std::vector<Lane> lanes;
+
+    StartupTrace() = default;
+
+    // Lane of the calling thread, numbered in order of first use (trace mutex held)
+    Lane& getLane()
+    {
+        thread_local int laneIndex = -1;
+        if (laneIndex < 0)
+        {
+            laneIndex = static_cast<int>(lanes.size());
+            lanes.push_back({ static_cast<unsigned int>(laneIndex + 1), std::string() });
+        }
+        return lanes[laneIndex];
+    }
+
+    // Quote a string for JSON
+    static std::string escape(const std::string& text)
+    {
+        std::string escaped;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            if (static_cast<unsigned char>(c) >= 0x20)
+                escaped += c;
+        }
+        return escaped;
+    }
+};
+
+// Span from construction to the end of the scope, named "action subject" (the name is only built when tracing).
+// A subject that has to be formatted is passed as a function returning it, so nothing is formatted when tracing is off,
+// e.g. TraceSpan span("texture", "upload", [&]() { return std::to_string(width); });
+class TraceSpan
+{
+public:
+    TraceSpan(const char* category, const char* action, const char* subject = "")
+        : category(category), active(StartupTrace::instance().isEnabled())
+    {
+        if (active)
+            start(action, subject);
+    }
+
+    TraceSpan(const char* category, const char* action, const std::string& subject)
+        : TraceSpan(category, action, subject.c_str())
+    {
+    }
+
+    template <typename F, typename = decltype(std::string(std::declval<F&>()()))>
+    TraceSpan(const char* category, const char* action, F describe)
+        : category(category), active(StartupTrace::instance().isEnabled())
+    {
+        if (active)
+            start(action, describe().c_str());
+    }
+
+    ~TraceSpan()
+    {
+        if (active)
+            StartupTrace::instance().addSpan(name, category, startUs, StartupTrace::now());
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* category;
+    bool active;
+    std::string name;
+    uint64_t startUs = 0;
+
+    // Name the span and take its start time (tracing on)
+    void start(const char* action, const char* subject)
+    {
+        name = action;
+        if (subject[0] != '\0')
+            name += std::string(" ") + subject;
+        startUs = StartupTrace::now();
+    }
+};
+#endif // MY_TRACE_H
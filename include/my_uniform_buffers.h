@@ -0,0 +1,95 @@
+#ifndef MY_UNIFORM_BUFFERS_H
+#define MY_UNIFORM_BUFFERS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <my_gl_counters.h>
+#include <my_shader.h>
+
+#include <cstring>
+
+// Fixed binding points, the same for every program
+const GLuint FRAME_UNIFORMS_BINDING = 0;
+const GLuint LIGHTS_BINDING = 1;
+
+// Number of point lights in the Lights block
+const unsigned int NUM_POINT_LIGHTS = 5;
+
+// std140 mirror of the FrameUniforms block in the shaders
+struct FrameUniforms
+{
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::vec3 viewPosition = glm::vec3(0.0f);
+    float time = 0.0f;      // Seconds since start, drives shader animation
+};
+static_assert(sizeof(FrameUniforms) == 144, "FrameUniforms must match the std140 layout");
+
+// std140 mirror of the PointLight struct (a float packs into the tail of a vec3)
+struct PointLightStd140
+{
+    glm::vec3 position = glm::vec3(0.0f);
+    float pad0 = 0.0f;
+    glm::vec3 ambient = glm::vec3(0.0f);
+    float pad1 = 0.0f;
+    glm::vec3 diffuse = glm::vec3(0.0f);
+    float pad2 = 0.0f;
+    glm::vec3 specular = glm::vec3(0.0f);
+    float constant = 1.0f;
+    float linear = 0.0f;
+    float quadratic = 0.0f;
+    float pad3[2] = { 0.0f, 0.0f };
+};
+static_assert(sizeof(PointLightStd140) == 80, "PointLightStd140 must match the std140 array stride");
+
+// std140 mirror of the Lights block in the fragment shader
+struct LightsUniforms
+{
+    PointLightStd140 pointLights[NUM_POINT_LIGHTS];
+};
+
+// Uniform buffer object bound to a fixed binding point.
+// Only writes to the buffer when the data differs from the last upload.
+template <typename T>
+class UniformBuffer
+{
+public:
+    // Create the buffer and attach it to its binding point
+    UniformBuffer(GLuint bindingPoint)
+    {
+        glGenBuffers(1, &UBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(T), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, UBO);
+    }
+
+    // Upload data with a single buffer write if it changed, returns true if it was written
+    bool update(const T& data)
+    {
+        if (uploaded && std::memcmp(&data, &lastData, sizeof(T)) == 0)
+            return false;
+
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        GLCounters::uniformBlockData(0, sizeof(T), &data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        lastData = data;
+        uploaded = true;
+        return true;
+    }
+
+private:
+    unsigned int UBO;
+    T lastData;
+    bool uploaded = false;
+};
+
+// Point a program's shared blocks at the fixed binding points (blocks it doesn't use are skipped)
+void bindSharedUniformBlocks(const Shader& shader)
+{
+    shader.bindUniformBlock("FrameUniforms", FRAME_UNIFORMS_BINDING);
+    shader.bindUniformBlock("Lights", LIGHTS_BINDING);
+}
+#endif // MY_UNIFORM_BUFFERS_H
@@ -0,0 +1,10 @@
+#version 330 core
+
+in vec4 vertexColor;
+
+out vec4 fragColor;     // Final fragment color
+
+void main()
+{
+    fragColor = vertexColor;
+}
@@ -0,0 +1,15 @@
+#version 330 core
+
+layout(location = 0) in vec2 position;  // Pixels from the top left of the screen
+layout(location = 1) in vec4 color;
+
+out vec4 vertexColor;
+
+uniform vec2 screenSize;    // Pixels
+
+void main()
+{
+    vec2 ndc = position / screenSize * 2.0 - 1.0;
+    vertexColor = color;
+    gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+}
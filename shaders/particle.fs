@@ -0,0 +1,22 @@
+#version 330 core
+
+in vec2 spriteCoord;    // Position on the sprite, -1 to 1
+in float fade;          // End of life fade
+
+out vec4 fragColor;     // Final fragment color
+
+uniform vec4 particleColor;   // RGBA
+uniform bool bubbleShading;   // Clear middle with a bright rim instead of a solid dot
+
+void main()
+{
+    // Round sprite
+    float radius2 = dot(spriteCoord, spriteCoord);
+    if (radius2 > 1.0)
+        discard;
+
+    float alpha = particleColor.a * fade;
+    if (bubbleShading)
+        alpha *= mix(0.25, 1.0, smoothstep(0.5, 1.0, radius2));
+    fragColor = vec4(particleColor.rgb, alpha);
+}
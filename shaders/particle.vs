@@ -0,0 +1,38 @@
+#version 330 core
+
+layout(location = 0) in vec2 corner;            // Quad corner, -1 to 1
+layout(location = 1) in vec4 positionAge;       // Per-instance particle state (see particleUpdate.vs)
+layout(location = 2) in vec4 velocityLifetime;
+layout(location = 3) in vec4 ownerSizeSeed;
+
+out vec2 spriteCoord;   // Position on the sprite, -1 to 1
+out float fade;         // Fades the particle out at the end of its life
+
+// Per-frame data shared by all programs (binding point 0)
+layout(std140) uniform FrameUniforms
+{
+    mat4 view;            // View matrix
+    mat4 projection;      // Projection matrix
+    vec3 viewPosition;    // Camera position
+    float time;           // Seconds since start
+};
+
+uniform float renderLag;  // Seconds the drawn frame is behind the last step
+
+void main()
+{
+    float age = positionAge.w;
+    float lifetime = velocityLifetime.w;
+    bool visible = lifetime >= 0.0 && age >= 0.0;
+
+    // Back along the velocity to the interpolated frame, then spread the corner in the camera plane
+    vec3 center = positionAge.xyz - velocityLifetime.xyz * renderLag;
+    vec3 cameraRight = vec3(view[0][0], view[1][0], view[2][0]);
+    vec3 cameraUp = vec3(view[0][1], view[1][1], view[2][1]);
+    float size = visible ? ownerSizeSeed.z : 0.0;   // Empty slots collapse to a point and draw nothing
+    vec3 position = center + (cameraRight * corner.x + cameraUp * corner.y) * size;
+
+    spriteCoord = corner;
+    fade = lifetime > 0.0 ? 1.0 - smoothstep(0.85, 1.0, age / lifetime) : 1.0;
+    gl_Position = projection * view * vec4(position, 1.0);
+}
@@ -0,0 +1,98 @@
+#version 330 core
+
+layout(location = 0) in vec4 positionAge;       // Position, seconds alive (negative while waiting to start)
+layout(location = 1) in vec4 velocityLifetime;  // Velocity, lifetime (negative for an empty slot)
+layout(location = 2) in vec4 ownerSizeSeed;     // Owner slot, owner generation, size, seed
+
+// Captured by transform feedback into the other state buffer
+out vec4 outPositionAge;
+out vec4 outVelocityLifetime;
+out vec4 outOwnerSizeSeed;
+
+uniform float stepSeconds;      // Length of the step being taken
+uniform float time;             // Simulation time of the step
+uniform int stepIndex;          // Seeds the random numbers of respawned particles
+
+uniform vec3 acceleration;      // Gravity or buoyancy
+uniform float drag;             // Fraction of the velocity lost per second
+uniform float wobbleAmplitude;  // Sideways sway speed
+uniform float wobbleFrequency;
+uniform float floorHeight;      // Particles die outside [floorHeight, ceilingHeight]
+uniform float ceilingHeight;
+
+uniform bool respawn;           // Restart expired particles at the emitter
+uniform vec3 emitterPosition;
+uniform float emitterRadius;
+uniform vec3 emitVelocity;
+uniform float emitVelocitySpread;
+uniform vec2 lifetimeRange;
+uniform vec2 sizeRange;
+
+uniform bool useOwners;                 // Kill particles whose owner's generation has moved on
+uniform isamplerBuffer ownerGenerations;
+
+// Integer hash, good enough to decorrelate neighbouring particles and steps
+uint hash(uint x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// Next random number in [0, 1)
+float random(inout uint state)
+{
+    state = hash(state);
+    return float(state >> 8) * (1.0 / 16777216.0);
+}
+
+void main()
+{
+    vec3 position = positionAge.xyz;
+    float age = positionAge.w;
+    vec3 velocity = velocityLifetime.xyz;
+    float lifetime = velocityLifetime.w;
+    vec4 extra = ownerSizeSeed;
+
+    bool alive = lifetime >= 0.0;
+    if (alive && age < 0.0)
+    {
+        // Waiting for its turn, doesn't move
+        age += stepSeconds;
+    }
+    else if (alive)
+    {
+        velocity += acceleration * stepSeconds;
+        velocity *= max(0.0, 1.0 - drag * stepSeconds);
+        float wobblePhase = time * wobbleFrequency + extra.w * 6.2831853;
+        vec3 wobble = wobbleAmplitude * vec3(sin(wobblePhase), 0.0, cos(wobblePhase * 0.7));
+        position += (velocity + wobble) * stepSeconds;
+        age += stepSeconds;
+
+        if (age >= lifetime || position.y < floorHeight || position.y > ceilingHeight)
+            alive = false;
+        else if (useOwners && extra.x >= 0.0 && texelFetch(ownerGenerations, int(extra.x)).r != int(extra.y))
+            alive = false;
+    }
+
+    if (!alive && respawn)
+    {
+        uint state = hash(uint(gl_VertexID) ^ hash(uint(stepIndex)));
+        float angle = random(state) * 6.2831853;
+        float radius = emitterRadius * sqrt(random(state));
+        position = emitterPosition + vec3(cos(angle) * radius, 0.0, sin(angle) * radius);
+        velocity = emitVelocity + (vec3(random(state), random(state), random(state)) * 2.0 - 1.0) * emitVelocitySpread;
+        age = 0.0;
+        lifetime = mix(lifetimeRange.x, lifetimeRange.y, random(state));
+        extra = vec4(-1.0, 0.0, mix(sizeRange.x, sizeRange.y, random(state)), random(state));
+    }
+    else if (!alive)
+        lifetime = -1.0;
+
+    outPositionAge = vec4(position, age);
+    outVelocityLifetime = vec4(velocity, lifetime);
+    outOwnerSizeSeed = extra;
+}
@@ -23,11 +23,22 @@ uniform sampler2D textureDiffuse4; // Diffuse texture
     float quadratic;// Attenuation quadratic term
  };
  
-// Point lights
-uniform PointLight pointLights[5];
+// Per-frame data shared by all programs (binding point 0)
+layout(std140) uniform FrameUniforms
+{
+    mat4 view;            // View matrix
+    mat4 projection;      // Projection matrix
+    vec3 viewPosition;    // Camera position
+    float time;           // Seconds since start
+};
+
+// Point lights shared by all programs (binding point 1)
+layout(std140) uniform Lights
+{
+    PointLight pointLights[5];
+};
 
 uniform float specularExponent;	// Specular exponent
-uniform vec3 viewPosition;     // Camera position
 uniform bool useTexture;       // Determines if texture should be used
 uniform vec4 glassColor;       // RGBA color for glass
 
@@ -3,19 +3,60 @@
 layout(location = 0) in vec3 vertexPosition;  // Vertex position
 layout(location = 1) in vec3 vertexNormal;    // Vertex normal
 layout(location = 2) in vec2 vertexTexCoords; // Texture coordinates
+layout(location = 3) in mat4 instanceMatrix;  // Per-instance model matrix (locations 3-6)
+layout(location = 7) in vec4 swimParams;      // Per-instance orbit: radius, phase, height, angular speed
+layout(location = 8) in float vertexSegment;  // Kelp segment the vertex belongs to
 
 out vec3 fragPos;    // To pass fragment position to fragment shader
 out vec3 normal;     // To pass normal vector to fragment shader
 out vec2 texCoords;  // To pass texture coordinates to fragment shader
 
+// Per-frame data shared by all programs (binding point 0)
+layout(std140) uniform FrameUniforms
+{
+    mat4 view;            // View matrix
+    mat4 projection;      // Projection matrix
+    vec3 viewPosition;    // Camera position
+    float time;           // Seconds since start
+};
+
 uniform mat4 model;       // Model matrix
-uniform mat4 view;        // View matrix
-uniform mat4 projection;  // Projection matrix
+uniform bool useInstancing; // Use per-instance model matrix instead of model uniform
+uniform bool useSwimAnimation; // Pose from swimParams and time instead
+uniform float swimSegmentPhase; // Tail wag phase of the mesh being drawn
+uniform bool useKelpSway;       // Bend by the sway of every segment up to vertexSegment
+
+// Circular orbit around the tank centre facing along the path, plus the tail wag
+mat4 swimMatrix()
+{
+    float theta = time * swimParams.w + swimParams.y;
+    float yaw = 4.71238898 - theta + 0.1 * sin(time * 5.0 + swimSegmentPhase);
+    float c = cos(yaw);
+    float s = sin(yaw);
+    vec3 position = vec3(swimParams.x * cos(theta), swimParams.z, swimParams.x * sin(theta));
+    return mat4(vec4(c, 0.0, -s, 0.0), vec4(0.0, 1.0, 0.0, 0.0), vec4(s, 0.0, c, 0.0), vec4(position, 1.0));
+}
+
+// Each segment sways about the stalk's Z axis relative to the one below, so the rotations add up
+mat4 kelpSwayMatrix()
+{
+    float angle = 0.0;
+    for (int k = 0; k <= int(vertexSegment); k++)
+        angle += 0.05 * sin(time * 0.75 + float(k) * 0.5);
+
+    float c = cos(angle);
+    float s = sin(angle);
+    return mat4(vec4(c, s, 0.0, 0.0), vec4(-s, c, 0.0, 0.0), vec4(0.0, 0.0, 1.0, 0.0), vec4(0.0, 0.0, 0.0, 1.0));
+}
 
 void main()
 {
-    fragPos = vec3(model * vec4(vertexPosition, 1.0)); 
-    normal = mat3(transpose(inverse(model))) * vertexNormal; 
+    mat4 modelMatrix = useSwimAnimation ? swimMatrix() : (useInstancing ? instanceMatrix : model);
+    if (useKelpSway)
+        modelMatrix = modelMatrix * kelpSwayMatrix();
+
+    fragPos = vec3(modelMatrix * vec4(vertexPosition, 1.0)); 
+    normal = mat3(transpose(inverse(modelMatrix))) * vertexNormal; 
     texCoords = vertexTexCoords; 
 
     gl_Position = projection * view * vec4(fragPos, 1.0); // Final position
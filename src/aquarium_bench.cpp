@@ -0,0 +1,362 @@
+// Microbenchmarks of the startup and per-frame kernels of the aquarium: pose to matrix, model placement, wall
+// constraints, model import per asset, texture decode, camera constraint checks and the creature updates.
+// Each benchmark warms up, then takes timed samples (each a batch of calls sized to take about a millisecond)
+// and reports the median and 99th percentile time per item; --json writes the same results for tracking over time.
+// Run it from the repository root (it loads the assets).
+// Usage: aquarium_bench [--json FILE] [--samples N] [--threads N] [--filter TEXT]
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <stb_image.h>
+
+#include <my_camera.h>
+#include <my_model.h>
+#include <my_mesh_cache.h>
+#include <my_scene_setup.h>
+#include <my_creatures.h>
+#include <my_boids.h>
+#include <my_job_system.h>
+#include <my_timing.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// One benchmark's timings, per item (one call of the kernel, or one element of a batched call)
+struct BenchResult
+{
+    std::string name;
+    unsigned int itemsPerCall = 1;
+    unsigned int callsPerSample = 1;
+    unsigned int samples = 0;
+    double medianNs = 0.0;
+    double p99Ns = 0.0;
+    double meanNs = 0.0;
+    double minNs = 0.0;
+};
+
+// Runs benchmarks and collects their results
+class BenchRunner
+{
+public:
+    unsigned int samples = 51;
+    std::string filter;             // Only benchmarks whose name contains this
+
+    // Time body (itemsPerCall items per call): warmup calls, then samples of enough calls to take targetMs each
+    template <typename F>
+    void run(const std::string& name, F body, unsigned int itemsPerCall = 1, unsigned int sampleCount = 0, double targetMs = 1.0)
+    {
+        if (!filter.empty() && name.find(filter) == std::string::npos)
+            return;
+        sampleCount = sampleCount > 0 ? sampleCount : samples;
+
+        // Warm up (caches, branch predictors, allocations) and size the batch from the slowest warm-up call
+        double warmupNs = 0.0;
+        for (int w = 0; w < 3; w++)
+            warmupNs = std::max(warmupNs, timeNs([&] { body(); }));
+        unsigned int calls = static_cast<unsigned int>(std::max(1.0, std::min(1.0e6, targetMs * 1.0e6 / std::max(1.0, warmupNs))));
+
+        std::vector<double> perItemNs;
+        perItemNs.reserve(sampleCount);
+        for (unsigned int s = 0; s < sampleCount; s++)
+        {
+            double sampleNs = timeNs([&]
+            {
+                for (unsigned int c = 0; c < calls; c++)
+                    body();
+            });
+            perItemNs.push_back(sampleNs / (double(calls) * itemsPerCall));
+        }
+        std::sort(perItemNs.begin(), perItemNs.end());
+
+        BenchResult result;
+        result.name = name;
+        result.itemsPerCall = itemsPerCall;
+        result.callsPerSample = calls;
+        result.samples = sampleCount;
+        result.medianNs = getSortedPercentile(perItemNs, 50.0);
+        result.p99Ns = getSortedPercentile(perItemNs, 99.0);
+        result.minNs = perItemNs.front();
+        for (double ns : perItemNs)
+            result.meanNs += ns / perItemNs.size();
+        results.push_back(result);
+        printResult(result);
+    }
+
+    // Table heading
+    static void printHeader()
+    {
+        std::cout << "  " << std::left << std::setw(48) << "benchmark" << std::right
+            << std::setw(14) << "median" << std::setw(14) << "p99" << std::setw(8) << "items" << std::setw(9) << "samples" << std::endl;
+    }
+
+    // Write every result as JSON, returns false if the file can't be written
+    bool writeJson(const std::string& path, unsigned int numThreads) const
+    {
+        std::ofstream out(path);
+        if (!out)
+        {
+            std::cout << "ERROR::BENCH::COULD_NOT_WRITE " << path << std::endl;
+            return false;
+        }
+        out << std::setprecision(6);
+        out << "{\n  \"benchmark\": \"aquarium_bench\",\n  \"unit\": \"ns per item\",\n  \"threads\": " << numThreads << ",\n  \"results\": [\n";
+        for (unsigned int i = 0; i < static_cast<unsigned int>(results.size()); i++)
+        {
+            const BenchResult& result = results[i];
+            out << "    { \"name\": \"" << result.name << "\", \"median_ns\": " << result.medianNs << ", \"p99_ns\": " << result.p99Ns
+                << ", \"mean_ns\": " << result.meanNs << ", \"min_ns\": " << result.minNs << ", \"items_per_call\": " << result.itemsPerCall
+                << ", \"calls_per_sample\": " << result.callsPerSample << ", \"samples\": " << result.samples << " }"
+                << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+        std::cout << "Results written to " << path << std::endl;
+        return true;
+    }
+
+private:
+    std::vector<BenchResult> results;
+
+    // Time with a unit that keeps it readable
+    static std::string formatNs(double ns)
+    {
+        std::ostringstream text;
+        text << std::fixed << std::setprecision(ns < 10.0 ? 2 : 1);
+        if (ns < 1.0e3)
+            text << ns << " ns";
+        else if (ns < 1.0e6)
+            text << ns / 1.0e3 << " us";
+        else
+            text << ns / 1.0e6 << " ms";
+        return text.str();
+    }
+
+    static void printResult(const BenchResult& result)
+    {
+        std::cout << "  " << std::left << std::setw(48) << result.name << std::right
+            << std::setw(14) << formatNs(result.medianNs) << std::setw(14) << formatNs(result.p99Ns)
+            << std::setw(8) << result.itemsPerCall << std::setw(9) << result.samples << std::endl;
+    }
+};
+
+// Mesh records without GL objects (the kernels below only touch poses and matrices)
+Model makePoseOnlyModel(unsigned int numMeshes)
+{
+    std::vector<MeshGeometry> noGeometry;
+    Model model(noGeometry);
+    for (unsigned int i = 0; i < numMeshes; i++)
+        model.meshes.push_back(Mesh(std::shared_ptr<MeshData>()));
+    return model;
+}
+
+// Main function
+int main(int argc, char** argv)
+{
+    BenchRunner runner;
+    std::string jsonPath;
+    unsigned int numThreads = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--json" && i + 1 < argc)
+            jsonPath = argv[++i];
+        else if (arg == "--samples" && i + 1 < argc)
+            runner.samples = static_cast<unsigned int>(std::max(5, std::atoi(argv[++i])));
+        else if (arg == "--threads" && i + 1 < argc)
+            numThreads = static_cast<unsigned int>(std::max(1, std::atoi(argv[++i])));
+        else if (arg == "--filter" && i + 1 < argc)
+            runner.filter = argv[++i];
+        else
+            std::cout << "Unknown option " << arg << " (usage: --json FILE --samples N --threads N --filter TEXT)" << std::endl;
+    }
+
+    const char* modelPaths[] =
+    {
+        MODEL_FLOOR, MODEL_WALLS, MODEL_ROOF, MODEL_FISH_TANK, MODEL_ROOF_LAMP, MODEL_KELP, MODEL_JELLYFISH, MODEL_JELLYFISH2,
+        MODEL_DIRT_FLOOR, MODEL_ROCK, MODEL_FISH1, MODEL_FISH2, MODEL_VOLCANO, MODEL_SHARK, MODEL_PAINTING, MODEL_TABLES,
+    };
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<float> across(-5.25f, 5.25f);
+    std::uniform_real_distribution<float> angle(-3.14159265f, 3.14159265f);
+    BenchRunner::printHeader();
+
+    // Model import per asset, with Assimp and from the cooked cache (the slow ones get fewer samples)
+    std::vector<std::vector<MeshGeometry>> geometries;
+    std::map<std::string, unsigned int> meshCounts;     // Meshes per imported model, by path
+    std::set<std::string> texturePaths;
+    for (const char* path : modelPaths)
+    {
+        std::vector<MeshGeometry> geometry;
+        if (!Model::importModel(path, geometry))
+            continue;
+        for (const MeshGeometry& mesh : geometry)
+            texturePaths.insert(mesh.texturePaths.begin(), mesh.texturePaths.end());
+
+        runner.run(std::string("import assimp ") + path, [&]
+        {
+            std::vector<MeshGeometry> imported;
+            Model::importModel(path, imported);
+        }, 1, std::min(runner.samples, 11u), 0.0);
+
+        std::vector<MeshGeometry> cached;
+        if (readMeshCache(path, cached))
+        {
+            runner.run(std::string("import cache ") + path, [&]
+            {
+                std::vector<MeshGeometry> imported;
+                readMeshCache(path, imported);
+            }, 1, std::min(runner.samples, 21u), 0.0);
+        }
+        meshCounts[path] = static_cast<unsigned int>(geometry.size());
+        geometries.push_back(std::move(geometry));
+    }
+
+    // Meshes of a model as imported (one if it didn't import), which is what main sizes the archetypes from
+    auto getMeshCount = [&](const char* path)
+    {
+        std::map<std::string, unsigned int>::const_iterator found = meshCounts.find(path);
+        return found == meshCounts.end() ? 1u : std::max(1u, found->second);
+    };
+
+    // Texture decode as the registry's workers do it (file already in memory)
+    stbi_set_flip_vertically_on_load(false);
+    for (const std::string& path : texturePaths)
+    {
+        std::ifstream file(path, std::ios::binary);
+        std::vector<unsigned char> fileBytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (fileBytes.empty())
+            continue;
+        runner.run("decode " + path, [&]
+        {
+            int width, height, numChannels;
+            stbi_image_free(stbi_load_from_memory(fileBytes.data(), static_cast<int>(fileBytes.size()), &width, &height, &numChannels, 0));
+        }, 1, std::min(runner.samples, 11u), 0.0);
+    }
+
+    // Mesh::updateModelMatrix over a batch of random poses
+    {
+        Model batch = makePoseOnlyModel(1024);
+        for (Mesh& mesh : batch.meshes)
+        {
+            mesh.mesh6DoF[tX] = across(gen); mesh.mesh6DoF[tY] = across(gen); mesh.mesh6DoF[tZ] = across(gen);
+            mesh.mesh6DoF[rX] = angle(gen); mesh.mesh6DoF[rY] = angle(gen); mesh.mesh6DoF[rZ] = angle(gen);
+        }
+        runner.run("Mesh::updateModelMatrix", [&]
+        {
+            for (Mesh& mesh : batch.meshes)
+                mesh.updateModelMatrix();
+        }, static_cast<unsigned int>(batch.meshes.size()));
+    }
+
+    // initModel on a prototype with as many meshes as the model that has the most
+    {
+        unsigned int numMeshes = 1;
+        for (unsigned int m = 0; m < static_cast<unsigned int>(geometries.size()); m++)
+            numMeshes = std::max(numMeshes, static_cast<unsigned int>(geometries[m].size()));
+        Model prototype = makePoseOnlyModel(numMeshes);
+        runner.run("initModel (" + std::to_string(numMeshes) + " meshes)", [&]
+        {
+            Model placed = initModel(prototype, 4.5f, 1.5f, 4.5f, 0.0f, 3.1f, 0.0f);
+            (void)placed;
+        });
+    }
+
+    // getWallConstraints on the wall model's vertices (passed by value, as main does)
+    std::vector<glm::vec3> wallVertices;
+    std::vector<MeshGeometry> wallGeometry;
+    if (Model::loadGeometry(MODEL_WALLS, wallGeometry))
+    {
+        for (const MeshGeometry& mesh : wallGeometry)
+        {
+            for (const Vertex& vertex : mesh.vertices)
+                wallVertices.push_back(vertex.Position);
+        }
+        runner.run("getWallConstraints (" + std::to_string(wallVertices.size()) + " vertices)", [&]
+        {
+            glm::vec4 constraints = getWallConstraints(wallVertices);
+            (void)constraints;
+        });
+    }
+
+    // Camera::checkPositionConstraints at random points around the room
+    {
+        Camera camera(glm::vec3(0.0f, 1.8f, 9.0f));
+        camera.setWallConstrains(wallVertices.empty() ? glm::vec4(-15.0f, 15.0f, -15.0f, 15.0f) : getWallConstraints(wallVertices));
+        std::uniform_real_distribution<float> room(-16.0f, 16.0f);
+        std::vector<glm::vec3> positions(1024);
+        for (glm::vec3& position : positions)
+            position = glm::vec3(room(gen), 1.8f, room(gen));
+        unsigned int allowed = 0;
+        runner.run("Camera::checkPositionConstraints", [&]
+        {
+            for (const glm::vec3& position : positions)
+                allowed += camera.checkPositionConstraints(position) ? 1 : 0;
+        }, static_cast<unsigned int>(positions.size()));
+        if (allowed == 0)
+            std::cout << "  (no position was allowed)" << std::endl;
+    }
+
+    // Creature updates: the demo populations, then ten times as many fish
+    JobSystem jobs(numThreads);
+    for (unsigned int scale : { 1u, 10u })
+    {
+        CreatureStore creatures;
+        creatures.fish1 = FishArchetype(getMeshCount(MODEL_FISH1));
+        creatures.fish2 = FishArchetype(getMeshCount(MODEL_FISH2));
+        creatures.shark = SharkArchetype(getMeshCount(MODEL_SHARK));
+        for (JellyfishArchetype* jellyfish : { &creatures.jellyfish1, &creatures.jellyfish2 })
+        {
+            for (int i = 0; i < 20; i++)
+                jellyfish->add(across(gen), 1.5f, across(gen), angle(gen), -0.5f * i);
+        }
+        for (FishArchetype* fish : { &creatures.fish1, &creatures.fish2 })
+        {
+            fish->reserve(75 * scale);
+            for (unsigned int i = 0; i < 75 * scale; i++)
+                fish->add(across(gen), 1.5f, across(gen), angle(gen), 1.0f * i);
+        }
+        creatures.shark.add(4.5f, 1.5f, 4.5f, 3.1f);
+        BoidSchool fish1School(creatures.fish1);
+        BoidSchool fish2School(creatures.fish2);
+
+        unsigned int numFish = creatures.fish1.size() + creatures.fish2.size();
+        std::string suffix = " (" + std::to_string(numFish) + " fish)";
+        const float stepSeconds = 1.0f / 60.0f;
+        float time = 0.0f;
+        runner.run("CreatureStore::update" + suffix, [&]
+        {
+            time += stepSeconds;
+            creatures.update(time, stepSeconds, jobs);
+        }, numFish);
+        runner.run("CreatureStore::buildMatrices" + suffix, [&]
+        {
+            creatures.buildMatrices(time, 0.5f, jobs);
+        }, numFish);
+        runner.run("BoidSchool::step" + suffix, [&]
+        {
+            fish1School.step(stepSeconds, jobs);
+            fish2School.step(stepSeconds, jobs);
+        }, numFish);
+        if (scale == 1)
+        {
+            runner.run("SharkArchetype orbit and buildMatrices", [&]
+            {
+                time += stepSeconds;
+                creatures.shark.orbit(time);
+                creatures.shark.buildMatrices(time, 0.5f);
+            });
+        }
+    }
+
+    if (!jsonPath.empty() && !runner.writeJson(jsonPath, jobs.size()))
+        return 1;
+    return 0;
+}
@@ -0,0 +1,76 @@
+// Benchmark of the boids neighbour queries: one school step with the spatial hash grid against testing every pair,
+// for a growing number of fish in the demo tank and in a tank grown to keep the density of the demo.
+// Runs on one thread so costs are per core.
+#include <my_boids.h>
+#include <my_creatures.h>
+#include <my_job_system.h>
+#include <my_timing.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+// Time grid build, grid step and (for small schools) brute force step for one school size
+void benchmarkSchool(unsigned int count, float tankScale, JobSystem& jobs)
+{
+    const int repeats = 9;
+    const float stepSeconds = 1.0f / 60.0f;
+    BoidParams params;
+    params.boundsMin *= tankScale;
+    params.boundsMax *= tankScale;
+    params.boundsMin.y = 0.3f;
+    params.boundsMax.y = 0.3f + 2.7f * tankScale;
+
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<float> across(params.boundsMin.x, params.boundsMax.x);
+    std::uniform_real_distribution<float> height(params.boundsMin.y, params.boundsMax.y);
+    std::uniform_real_distribution<float> heading(-3.14159265f, 3.14159265f);
+    FishArchetype fish;
+    fish.reserve(count);
+    for (unsigned int i = 0; i < count; i++)
+        fish.add(across(gen), height(gen), across(gen), heading(gen));
+
+    BoidSchool school(fish);
+    school.params = params;
+
+    SpatialHashGrid grid;
+    double buildMs = timeMedian([&] { grid.build(fish.x.data(), fish.y.data(), fish.z.data(), count, params.neighborRadius); }, repeats);
+    double gridMs = timeMedian([&] { school.step(stepSeconds, jobs); }, repeats);
+    BoidStats stats = school.getStats();
+
+    std::cout << "  " << std::setw(7) << count << std::fixed << std::setprecision(3)
+        << std::setw(10) << buildMs << std::setw(11) << gridMs
+        << std::setw(9) << std::setprecision(0) << gridMs * 1.0e6 / count
+        << std::setw(11) << std::setprecision(1) << double(stats.candidatesTested) / count
+        << std::setw(10) << double(stats.neighborsFound) / count;
+
+    // Every pair, only where it finishes in reasonable time (no neighbour cap, so no early exit)
+    if (count <= 20000)
+    {
+        school.bruteForceNeighbors = true;
+        school.params.maxNeighbors = std::numeric_limits<unsigned int>::max();
+        double bruteMs = timeMedian([&] { school.step(stepSeconds, jobs); }, count <= 5000 ? repeats : 1);
+        std::cout << std::setw(12) << std::setprecision(3) << bruteMs << std::setw(9) << std::setprecision(1) << bruteMs / gridMs << "x";
+    }
+    std::cout << std::defaultfloat << std::endl;
+}
+
+// Main function
+int main()
+{
+    const unsigned int counts[] = { 150, 1000, 2000, 5000, 10000, 20000, 50000, 100000 };
+    JobSystem jobs(1);
+
+    for (int mode = 0; mode < 2; mode++)
+    {
+        std::cout << (mode == 0 ? "Demo tank" : "Tank grown to the demo density (150 fish)") << std::endl;
+        std::cout << "     fish  build ms  step ms  ns/fish  candidates  neighbors  brute ms  grid gain" << std::endl;
+        for (unsigned int count : counts)
+            benchmarkSchool(count, mode == 0 ? 1.0f : std::cbrt(count / 150.0f), jobs);
+    }
+    return 0;
+}
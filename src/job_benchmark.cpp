@@ -0,0 +1,62 @@
+// Scaling benchmark of the parallel creature update: one CreatureStore step plus matrix build at 1..N threads.
+// Usage: job_benchmark [fish per population] [max threads]
+#include <my_creatures.h>
+#include <my_job_system.h>
+#include <my_timing.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Main function
+int main(int argc, char** argv)
+{
+    unsigned int numFish = argc > 1 ? static_cast<unsigned int>(std::atoi(argv[1])) : 100000;
+    unsigned int maxThreads = argc > 2 ? static_cast<unsigned int>(std::atoi(argv[2])) : JobSystem::defaultThreadCount();
+    unsigned int numJellyfish = numFish / 4;
+    const int repeats = 31;
+
+    // Same spread as the demo tank, scaled up
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<float> across(-5.25f, 5.25f);
+    std::uniform_real_distribution<float> height(0.5f, 2.8f);
+    std::uniform_real_distribution<float> heading(0.0f, 3.14159265f);
+    CreatureStore creatures;
+    for (FishArchetype* fish : { &creatures.fish1, &creatures.fish2 })
+    {
+        fish->reserve(numFish);
+        for (unsigned int i = 0; i < numFish; i++)
+            fish->add(across(gen), height(gen), across(gen), heading(gen), 1.0f * i);
+    }
+    for (JellyfishArchetype* jellyfish : { &creatures.jellyfish1, &creatures.jellyfish2 })
+    {
+        jellyfish->reserve(numJellyfish);
+        for (unsigned int i = 0; i < numJellyfish; i++)
+            jellyfish->add(across(gen), height(gen), across(gen), heading(gen), -0.5f * i);
+    }
+
+    std::cout << "Creature update scaling: " << 2 * numFish << " fish, " << 2 * numJellyfish << " jellyfish, grain "
+        << CREATURE_UPDATE_GRAIN << std::endl;
+    double singleThreadMs = 0.0;
+    float time = 0.0f;
+    for (unsigned int threads = 1; threads <= std::max(1u, maxThreads); threads++)
+    {
+        JobSystem jobs(threads);
+        double ms = timeMedian([&]
+        {
+            time += 1.0f / 60.0f;
+            creatures.update(time, 1.0f / 60.0f, jobs);
+            creatures.buildMatrices(time, 0.5f, jobs);
+        }, repeats);
+        if (threads == 1)
+            singleThreadMs = ms;
+
+        std::cout << "  " << std::setw(3) << threads << " threads: " << std::fixed << std::setprecision(3) << std::setw(9) << ms
+            << " ms  speedup " << std::setprecision(2) << singleThreadMs / ms << "x  efficiency "
+            << std::setprecision(0) << 100.0 * singleThreadMs / ms / threads << "%" << std::defaultfloat << std::endl;
+    }
+    return 0;
+}
@@ -4,9 +4,35 @@
 #include <my_shader.h>
 #include <my_camera.h>
 #include <my_model.h>
-
+#include <my_scene_loader.h>
+#include <my_scene_setup.h>
+#include <my_instanced_model.h>
+#include <my_swim_batch.h>
+#include <my_kelp_batch.h>
+#include <my_uniform_buffers.h>
+#include <my_frustum.h>
+#include <my_creatures.h>
+#include <my_boids.h>
+#include <my_feeding.h>
+#include <my_particles.h>
+#include <my_headless.h>
+#include <my_gl_counters.h>
+#include <my_replay.h>
+#include <my_profiler.h>
+#include <my_hud.h>
+#include <my_trace.h>
+#include <my_job_system.h>
+#include <my_simulation_clock.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <memory>
 #include <random>
+#include <string>
 #define _USE_MATH_DEFINES
 #include <math.h>
 
@@ -43,228 +69,501 @@ float yPrev = static_cast<float>(SCREEN_HEIGHT) / 2.0f;
 float deltaTime = 0.0f;	// time between current frame and previous frame
 float prevFrame = 0.0f;
 
-// For random placement of models
+// Random placement of models, seeded once so a seed (--seed, or a replay's) reproduces the scene
+std::mt19937 sceneRandom;
+
 float generateRandomNumInRange(float low, float high)
 {
-    std::random_device rd;
-    std::mt19937 gen(rd());
     std::uniform_real_distribution<float> dis(low, high);
 
-    return dis(gen);
+    return dis(sceneRandom);
 }
 
-// 3D model names
-#define MODEL_FLOOR "models/floor.obj"
-#define MODEL_WALLS "models/walls.obj"
-#define MODEL_ROOF "models/roof.obj"
-#define MODEL_FISH_TANK "models/fish_tank.obj"
-#define MODEL_ROOF_LAMP "models/roof_lamp.obj"
-#define MODEL_KELP "models/kelp.obj"
-#define MODEL_JELLYFISH "models/jellyfish.obj"
-#define MODEL_JELLYFISH2 "models/jellyfish2.obj"
-#define MODEL_DIRT_FLOOR "models/dirt_floor.obj"
-#define MODEL_ROCK "models/rock.obj"
-#define MODEL_FISH1 "models/fish1.obj"
-#define MODEL_FISH2 "models/fish2.obj"
-#define MODEL_VOLCANO "models/volcano.obj"
-#define MODEL_FISH_FOOD "models/fish_food.obj"
-#define MODEL_SHARK "models/shark.obj"
-#define MODEL_PAINTING "models/painting1.obj"
-#define MODEL_TABLES "models/tables.obj"
-
-// Function to init models
-Model initModel(Model _model, const float _tX, const float _tY, 
-    const float _tZ, const float _rX, const float _rY, const float _rZ)
+// Scripted tours advance by a fixed time per frame
+const float TOUR_FRAME_SECONDS = 1.0f / 60.0f;
+
+// Refill a batch with the on-screen meshes of a population (one world matrix per mesh, or one shared by all)
+void addVisibleInstances(InstancedModel& batch, const Model& prototype, const CreaturePopulation& population, FrustumCuller& culler)
 {
-    Model model = _model;
-    for (unsigned int i = 0; i < static_cast<unsigned int>(model.meshes.size()); i++)
+    batch.clear();
+    unsigned int segments = population.getSegmentsPerCreature();
+    for (unsigned int i = 0; i < population.size(); i++)
     {
-        // Base mesh, rotated and translated
-        if (i == 0)
+        for (unsigned int j = 0; j < static_cast<unsigned int>(prototype.meshes.size()); j++)
         {
-            // Set 6 DoF pose params
-            model.meshes[i].mesh6DoF[tX] = _tX; model.meshes[i].mesh6DoF[tY] = _tY; model.meshes[i].mesh6DoF[tZ] = _tZ;
-            model.meshes[i].mesh6DoF[rX] = _rX; model.meshes[i].mesh6DoF[rY] = _rY; model.meshes[i].mesh6DoF[rZ] = _rZ;
-
-            // Rotations in radians, X, Y, then Z
-            glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), _rX, glm::vec3(1.0f, 0.0f, 0.0f));
-            rotation = glm::rotate(rotation, _rY, glm::vec3(0.0f, 1.0f, 0.0f));
-            rotation = glm::rotate(rotation, _rZ, glm::vec3(0.0f, 0.0f, 1.0f));
-
-            // Translation
-            glm::mat4 translation = glm::translate(glm::mat4(1.0f), glm::vec3(tX, tY, tZ));
-            model.meshes[i].meshMatrix = rotation * translation;
+            const glm::mat4& worldMatrix = population.getWorldMatrix(i, j < segments ? j : 0);
+            if (culler.isMeshVisible(*prototype.meshes[j].data, worldMatrix))
+                batch.addInstance(j, worldMatrix);
         }
-        // Rest of meshes lower in hierarchy, identity for now
-        else
-            model.meshes[i].meshMatrix = glm::mat4(1);
-
-        model.meshes[i].updateModelMatrix();
     }
-    return model;
 }
 
-// Fish food animation
-bool fishFoodInit = false;
-bool fishFoodAnimStarted = false;
+// Fish swim fixed orbits evaluated in the vertex shader (--orbit-fish) instead of schooling on the CPU
+bool gpuFishAnimation = false;
+
+// Fish food drops asked for with F since the last simulation step
+unsigned int fishFoodDropRequests = 0;
+bool fishFoodKeyDown = false;
 
-// Wall constrains function
-glm::vec4 getWallConstraints(std::vector<glm::vec3> modelVertices)
+// Profiler and GL call overlay, toggled with H
+bool showProfilerHud = false;
+bool profilerKeyDown = false;
+
+// Each food pellet is drawn as a little cloud of flakes
+const unsigned int FLAKES_PER_PELLET = 12;
+const float FLAKE_SPREAD = 0.06f;
+
+// Queue the flakes of the pellets dropped since the last call, owned by their pellet so they vanish with it.
+// Each pellet slot has its own FLAKES_PER_PELLET particles, so flakes of live pellets are never overwritten.
+void emitFoodFlakes(ParticleSystem& flakes, FeedingSystem& feeding, std::mt19937& random)
 {
-    float xMin{}, xMax{}, zMin{}, zMax{};
-    for (int i = 0; i < (int)modelVertices.size(); i++)
+    std::uniform_real_distribution<float> offset(-FLAKE_SPREAD, FLAKE_SPREAD);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (const PelletDrop& drop : feeding.getNewDrops())
     {
-        // If first loop, just set
-        if (i == 0)
-        {
-            xMin = xMax = modelVertices[i].x;
-            zMin = zMax = modelVertices[i].z;
+        // Eaten or dissolved within the same frame
+        if (!feeding.isInTank(drop))
             continue;
+
+        glm::vec3 pelletPosition = feeding.getSlotPosition(drop.slot);
+        for (unsigned int i = 0; i < FLAKES_PER_PELLET; i++)
+        {
+            Particle flake;
+            float offsetX = offset(random);
+            float offsetY = offset(random);
+            float offsetZ = offset(random);
+            flake.position = pelletPosition + glm::vec3(offsetX, offsetY, offsetZ);
+            flake.velocity = glm::vec3(0.0f, -feeding.params.sinkSpeed, 0.0f);
+            flake.lifetime = 1.0e6f;    // Lives as long as its pellet
+            flake.ownerSlot = static_cast<float>(drop.slot);
+            flake.ownerGeneration = static_cast<float>(drop.generation);
+            flake.size = 0.012f + 0.008f * unit(random);
+            flake.seed = unit(random);
+            flakes.emit(drop.slot * FLAKES_PER_PELLET + i, flake);
         }
+    }
+    feeding.clearNewDrops();
+}
+
+// GL calls of a frame and what culling skipped, as a table at x, y on the overlay
+void addGLCountersToHud(HudOverlay& hud, const FrameGLCounters& counters, const CullingStats& culling, float x, float y)
+{
+    const float line = HudOverlay::getLineHeight();
+    const std::pair<const char*, uint64_t> rows[] =
+    {
+        { "DRAW CALLS", counters.drawCalls },
+        { "INDICES", counters.indices },
+        { "TRIANGLES", counters.triangles },
+        { "TEXTURE BINDS", counters.textureBinds },
+        { "PROGRAM SWITCHES", counters.programSwitches },
+        { "VAO BINDS", counters.vaoBinds },
+        { "UNIFORM UPLOADS", counters.uniformUploads },
+        { "MODELS CULLED", culling.modelsCulled },
+        { "MESHES CULLED", culling.meshesCulled },
+    };
 
-        // Else compare to find constraints
-        if (modelVertices[i].x < xMin)
-            xMin = modelVertices[i].x;
-        if (modelVertices[i].x > xMax)
-            xMax = modelVertices[i].x;
-        if (modelVertices[i].z < zMin)
-            zMin = modelVertices[i].z;
-        if (modelVertices[i].z > zMax)
-            zMax = modelVertices[i].z;
+    hud.addRect(x - line * 0.5f, y - line * 0.5f, HudOverlay::getCharacterAdvance() * 28.0f + line, line * 11.0f, glm::vec4(0.0f, 0.0f, 0.0f, 0.6f));
+    hud.addText(x, y, "GL CALLS PER FRAME", glm::vec4(0.7f, 0.9f, 1.0f, 1.0f));
+    char text[64];
+    for (const std::pair<const char*, uint64_t>& row : rows)
+    {
+        y += line;
+        std::snprintf(text, sizeof(text), "%-17s %10llu", row.first, static_cast<unsigned long long>(row.second));
+        hud.addText(x, y, text, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
     }
+}
 
-    // Adjust slightly so not exactly "in wall"
-    xMin += 0.25f; xMax -= 0.25f;
-    zMin += 0.25f; zMax -= 0.25f;
+// Top of a model's geometry (centre of the vertices within a small distance of the highest), e.g. a volcano's vent
+glm::vec3 getModelTop(const Model& prototype, float tolerance)
+{
+    float top = -1.0e9f;
+    for (const Mesh& mesh : prototype.meshes)
+    {
+        for (const Vertex& vertex : mesh.data->vertices)
+            top = std::max(top, vertex.Position.y);
+    }
 
-    return glm::vec4(xMin, xMax, zMin, zMax);
+    glm::vec3 sum(0.0f);
+    unsigned int count = 0;
+    for (const Mesh& mesh : prototype.meshes)
+    {
+        for (const Vertex& vertex : mesh.data->vertices)
+        {
+            if (vertex.Position.y > top - tolerance)
+            {
+                sum += vertex.Position;
+                count++;
+            }
+        }
+    }
+    return count > 0 ? sum / float(count) : glm::vec3(0.0f);
 }
 
 // Main function
-int main()
+int main(int argc, char** argv)
 {
-    // glfw init and configure
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_DECORATED, NULL); // Remove title bar
-
-    // Screen params
-    GLFWmonitor* MyMonitor = glfwGetPrimaryMonitor(); 
-    const GLFWvidmode* mode = glfwGetVideoMode(MyMonitor);
-    SCREEN_WIDTH = mode->width; SCREEN_HEIGHT = mode->height;
-
-    // glfw window creation
-    GLFWwindow* window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Acquarium Scene", glfwGetPrimaryMonitor(), nullptr);
-    if (window == NULL)
+    // Startup phases are timed from here (written out with --trace)
+    uint64_t startupStart = StartupTrace::now();
+
+    // Command line options
+    unsigned int numUpdateThreads = JobSystem::defaultThreadCount();
+    double simulationRate = 60.0;
+    unsigned int numBubbles = 4096;
+    unsigned int numFish = 75;
+    bool headless = false;
+    unsigned int headlessWidth = 1920, headlessHeight = 1080;
+    unsigned int numFrames = 600, numWarmupFrames = 30;
+    std::string screenshotPath, statsPath, glLogPath;
+    unsigned int sceneSeed = std::random_device()();
+    std::string recordPath, replayPath, tourName;
+    std::string tracePath;
+    for (int i = 1; i < argc; i++)
     {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc)
+            numUpdateThreads = static_cast<unsigned int>(std::max(1, std::atoi(argv[++i])));
+        else if (arg == "--sim-rate" && i + 1 < argc)
+            simulationRate = std::atof(argv[++i]);
+        else if (arg == "--orbit-fish")
+            gpuFishAnimation = true;
+        else if (arg == "--bubbles" && i + 1 < argc)
+            numBubbles = static_cast<unsigned int>(std::max(1, std::atoi(argv[++i])));
+        else if (arg == "--fish" && i + 1 < argc)
+            numFish = static_cast<unsigned int>(std::max(1, std::atoi(argv[++i])));
+        else if (arg == "--headless")
+            headless = true;
+        else if (arg == "--size" && i + 1 < argc)
+        {
+            if (std::sscanf(argv[++i], "%ux%u", &headlessWidth, &headlessHeight) != 2 || headlessWidth == 0 || headlessHeight == 0)
+                std::cout << "ERROR::OPTIONS::SIZE_MUST_BE_WIDTHxHEIGHT" << std::endl;
+        }
+        else if (arg == "--frames" && i + 1 < argc)
+            numFrames = static_cast<unsigned int>(std::max(1, std::atoi(argv[++i])));
+        else if (arg == "--warmup" && i + 1 < argc)
+            numWarmupFrames = static_cast<unsigned int>(std::max(0, std::atoi(argv[++i])));
+        else if (arg == "--screenshot" && i + 1 < argc)
+            screenshotPath = argv[++i];
+        else if (arg == "--stats" && i + 1 < argc)
+            statsPath = argv[++i];
+        else if (arg == "--gl-log" && i + 1 < argc)
+            glLogPath = argv[++i];
+        else if (arg == "--seed" && i + 1 < argc)
+            sceneSeed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--record" && i + 1 < argc)
+            recordPath = argv[++i];
+        else if (arg == "--replay" && i + 1 < argc)
+            replayPath = argv[++i];
+        else if (arg == "--tour" && i + 1 < argc)
+            tourName = argv[++i];
+        else if (arg == "--hud")
+            showProfilerHud = true;
+        else if (arg == "--trace" && i + 1 < argc)
+            tracePath = argv[++i];
+        else
+            std::cout << "Unknown option " << arg << " (usage: --threads N --sim-rate HZ --orbit-fish --bubbles N --fish N"
+                " --headless --size WxH --frames N --warmup N --screenshot FILE.ppm --stats FILE.json --gl-log FILE.csv --seed N --record FILE"
+                " --replay FILE --tour " << CameraTour::getNames() << " --hud --trace FILE.json)" << std::endl;
     }
-    glfwMakeContextCurrent(window);
 
-    // Callback functions
-    glfwSetFramebufferSizeCallback(window, frameBufferSizeCallback);
-    glfwSetCursorPosCallback(window, mouseCallback);
-    glfwSetScrollCallback(window, scrollCallback);
+    // A replay runs the scene it was recorded in, whatever the options say
+    InputReplay inputReplay;
+    bool replaying = !replayPath.empty();
+    if (replaying)
+    {
+        if (!inputReplay.open(replayPath))
+            return -1;
+        sceneSeed = inputReplay.header.seed;
+        simulationRate = inputReplay.header.simulationRate;
+        gpuFishAnimation = (inputReplay.header.flags & REPLAY_FLAG_ORBIT_FISH) != 0;
+        numBubbles = inputReplay.header.numBubbles;
+        numFish = inputReplay.header.numFish;
+        std::cout << "Replaying " << inputReplay.size() << " frames from " << replayPath << std::endl;
+    }
 
-    // Mouse capture
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    // Or a built in camera tour
+    CameraTour cameraTour;
+    bool touring = !replaying && !tourName.empty();
+    if (touring && !cameraTour.load(tourName, yPos, cameraZoom))
+    {
+        std::cout << "ERROR::OPTIONS::UNKNOWN_TOUR " << tourName << " (tours: " << CameraTour::getNames() << ")" << std::endl;
+        return -1;
+    }
+    sceneRandom.seed(sceneSeed);
+    std::cout << "Scene seed " << sceneSeed << std::endl;
 
-    // Load all OpenGL function pointers with GLAD
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    // Every frame's input goes to the log (--record), replayable with --replay
+    InputRecorder inputRecorder;
+    if (!recordPath.empty())
     {
-        std::cout << "Failed to initialize GLAD" << std::endl;
+        ReplayHeader runHeader = {};
+        runHeader.seed = sceneSeed;
+        runHeader.flags = gpuFishAnimation ? REPLAY_FLAG_ORBIT_FISH : 0;
+        runHeader.simulationRate = static_cast<float>(simulationRate);
+        runHeader.numBubbles = numBubbles;
+        runHeader.numFish = numFish;
+        if (!inputRecorder.open(recordPath, runHeader))
+            return -1;
+    }
+
+    // Every frame's GL calls go to a CSV (--gl-log)
+    GLCounterLog glCounterLog;
+    if (!glLogPath.empty() && !glCounterLog.open(glLogPath))
         return -1;
+
+    if (!tracePath.empty())
+    {
+        StartupTrace::instance().enable();
+        StartupTrace::instance().nameThread("main (GL)");
+    }
+    uint64_t phaseStart = StartupTrace::instance().endPhase("options", startupStart);
+
+    // Offscreen context rendering into a framebuffer (--headless), or a fullscreen window
+    HeadlessContext headlessContext;
+    std::unique_ptr<OffscreenTarget> offscreenTarget;
+    GLFWwindow* window = nullptr;
+    if (headless)
+    {
+        SCREEN_WIDTH = headlessWidth; SCREEN_HEIGHT = headlessHeight;
+        if (!headlessContext.create() || !gladLoadGLLoader(HeadlessContext::getLoader()))
+        {
+            std::cout << "Failed to create headless OpenGL context" << std::endl;
+            return -1;
+        }
+        offscreenTarget.reset(new OffscreenTarget(SCREEN_WIDTH, SCREEN_HEIGHT));
+        offscreenTarget->bind();
+    }
+    else
+    {
+        // glfw init and configure
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_DECORATED, NULL); // Remove title bar
+
+        // Screen params
+        GLFWmonitor* MyMonitor = glfwGetPrimaryMonitor(); 
+        const GLFWvidmode* mode = glfwGetVideoMode(MyMonitor);
+        SCREEN_WIDTH = mode->width; SCREEN_HEIGHT = mode->height;
+
+        // glfw window creation
+        window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Acquarium Scene", glfwGetPrimaryMonitor(), nullptr);
+        if (window == NULL)
+        {
+            std::cout << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(window);
+
+        // Callback functions
+        glfwSetFramebufferSizeCallback(window, frameBufferSizeCallback);
+        glfwSetCursorPosCallback(window, mouseCallback);
+        glfwSetScrollCallback(window, scrollCallback);
+
+        // Mouse capture
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+        // Load all OpenGL function pointers with GLAD
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+        {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            return -1;
+        }
     }
 
+    phaseStart = StartupTrace::instance().endPhase("create context", phaseStart);
+
     // Configure global OpenGL state
     glEnable(GL_DEPTH_TEST);    // Depth-testing
     glDepthFunc(GL_LESS);       // Smaller value as "closer" for depth-testing
 
     // Build and compile shaders
     Shader shader("shaders/projectVertexShader.vs", "shaders/projectFragmentShader.fs");
-
-    // Load models
-    Model floorModel(MODEL_FLOOR);
-    Model wallModel(MODEL_WALLS);
-    Model roofModel(MODEL_ROOF);
-    Model fishTankModel(MODEL_FISH_TANK);
-    Model roofLampModel(MODEL_ROOF_LAMP);
-    Model kelpModel(MODEL_KELP);
-    Model jellyfishModel(MODEL_JELLYFISH);
-    Model jellyfish2Model(MODEL_JELLYFISH2);
-    Model dirtFloorModel(MODEL_DIRT_FLOOR);
-    Model rockModel(MODEL_ROCK);
-    Model fish1Model(MODEL_FISH1);
-    Model fish2Model(MODEL_FISH2);
-    Model volcanoModel(MODEL_VOLCANO);
-    Model fishFoodModel(MODEL_FISH_FOOD);
-    Model sharkModel(MODEL_SHARK);
-    Model paintingModel(MODEL_PAINTING);
-    Model tablesModel(MODEL_TABLES);
-
-    // Create 150 kelp models, each with 8 segments
-    std::vector<Model> kelpModels;
+    Shader particleUpdateShader("shaders/particleUpdate.vs", { "outPositionAge", "outVelocityLifetime", "outOwnerSizeSeed" });
+    Shader particleShader("shaders/particle.vs", "shaders/particle.fs");
+    phaseStart = StartupTrace::instance().endPhase("shaders", phaseStart);
+
+    // Load models (imported in parallel, then uploaded here)
+    SceneLoader sceneLoader;
+    sceneLoader.add(MODEL_FLOOR);
+    sceneLoader.add(MODEL_WALLS);
+    sceneLoader.add(MODEL_ROOF);
+    sceneLoader.add(MODEL_FISH_TANK);
+    sceneLoader.add(MODEL_ROOF_LAMP);
+    sceneLoader.add(MODEL_KELP);
+    sceneLoader.add(MODEL_JELLYFISH);
+    sceneLoader.add(MODEL_JELLYFISH2);
+    sceneLoader.add(MODEL_DIRT_FLOOR);
+    sceneLoader.add(MODEL_ROCK);
+    sceneLoader.add(MODEL_FISH1);
+    sceneLoader.add(MODEL_FISH2);
+    sceneLoader.add(MODEL_VOLCANO);
+    sceneLoader.add(MODEL_SHARK);
+    sceneLoader.add(MODEL_PAINTING);
+    sceneLoader.add(MODEL_TABLES);
+    sceneLoader.load();
+
+    Model floorModel = sceneLoader.getModel(MODEL_FLOOR);
+    Model wallModel = sceneLoader.getModel(MODEL_WALLS);
+    Model roofModel = sceneLoader.getModel(MODEL_ROOF);
+    Model fishTankModel = sceneLoader.getModel(MODEL_FISH_TANK);
+    Model roofLampModel = sceneLoader.getModel(MODEL_ROOF_LAMP);
+    Model kelpModel = sceneLoader.getModel(MODEL_KELP);
+    Model jellyfishModel = sceneLoader.getModel(MODEL_JELLYFISH);
+    Model jellyfish2Model = sceneLoader.getModel(MODEL_JELLYFISH2);
+    Model dirtFloorModel = sceneLoader.getModel(MODEL_DIRT_FLOOR);
+    Model rockModel = sceneLoader.getModel(MODEL_ROCK);
+    Model fish1Model = sceneLoader.getModel(MODEL_FISH1);
+    Model fish2Model = sceneLoader.getModel(MODEL_FISH2);
+    Model volcanoModel = sceneLoader.getModel(MODEL_VOLCANO);
+    Model sharkModel = sceneLoader.getModel(MODEL_SHARK);
+    Model paintingModel = sceneLoader.getModel(MODEL_PAINTING);
+    Model tablesModel = sceneLoader.getModel(MODEL_TABLES);
+    phaseStart = StartupTrace::instance().endPhase("models", phaseStart);
+    // Textures decode on worker threads while the models load, finish uploading them before rendering
+    TextureRegistry::instance().waitForUploads();
+    TextureRegistry::instance().printReport();
+    phaseStart = StartupTrace::instance().endPhase("textures", phaseStart);
+
+    // Creature populations, stored as arrays per attribute
+    CreatureStore creatures;
+    creatures.fish1 = FishArchetype(static_cast<unsigned int>(fish1Model.meshes.size()));
+    creatures.fish2 = FishArchetype(static_cast<unsigned int>(fish2Model.meshes.size()));
+    creatures.shark = SharkArchetype(static_cast<unsigned int>(sharkModel.meshes.size()));
+
+    // 150 kelp stalks (each random draw in its own statement: argument evaluation order is unspecified,
+    // and a seed has to give the same layout whatever the compiler)
+    creatures.kelp.reserve(150);
     for (int i = 0; i < 150; i++)
-        kelpModels.push_back(initModel(kelpModel, generateRandomNumInRange(-5.25f, 5.25f), 0.0f, generateRandomNumInRange(-5.25f, 5.25f),
-            0.0f, glm::radians(generateRandomNumInRange(0.0f, 180.0f)), 0.0f));
-
-    // Create 20 jellyfish 1s
-    std::vector<Model> jellyfish1Models;
-    for (int i = 0; i < 20; i++)
-        jellyfish1Models.push_back(initModel(jellyfishModel, generateRandomNumInRange(-5.25f, 5.25f), generateRandomNumInRange(0.5f, 2.5f), generateRandomNumInRange(-5.25f, 5.25f),
-            0.0f, glm::radians(generateRandomNumInRange(0.0f, 180.0f)), 0.0f));
-
-    // Create 20 jellyfish 2s
-    std::vector<Model> jellyfish2Models;
-    for (int i = 0; i < 20; i++)
-        jellyfish2Models.push_back(initModel(jellyfish2Model, generateRandomNumInRange(-5.25f, 5.25f), generateRandomNumInRange(0.5f, 2.5f), generateRandomNumInRange(-5.25f, 5.25f),
-            0.0f, glm::radians(generateRandomNumInRange(0.0f, 180.0f)), 0.0f));
-
-    // Shark model
-    sharkModel = initModel(sharkModel, 4.5f, generateRandomNumInRange(1.0f, 2.0f), 4.5f,
-        0.0f, glm::radians(generateRandomNumInRange(175.0f, 185.0f)), 0.0f);
-    sharkModel.meshes[0].initRad = std::sqrtf(std::powf(sharkModel.meshes[0].mesh6DoF[tX], 2.0f) + std::powf(sharkModel.meshes[0].mesh6DoF[tZ], 2.0f));
-    sharkModel.meshes[0].initRot = sharkModel.meshes[0].mesh6DoF[rY];
-
-    // 75 fish 1s
-    std::vector<Model> fish1Models;
-    for (int i = 0; i < 75; i++)
     {
-        fish1Models.push_back(initModel(fish1Model, generateRandomNumInRange(-5.25f, 5.25f), generateRandomNumInRange(0.5f, 2.8f), generateRandomNumInRange(-5.25f, 5.25f),
-            0.0f, glm::radians(generateRandomNumInRange(175.0f, 185.0f)), 0.0f));
-        fish1Models[i].meshes[0].initRad = std::sqrtf(std::powf(fish1Models[i].meshes[0].mesh6DoF[tX], 2.0f) + std::powf(fish1Models[i].meshes[0].mesh6DoF[tZ], 2.0f));
-        fish1Models[i].meshes[0].initRot = fish1Models[i].meshes[0].mesh6DoF[rY];
+        float x = generateRandomNumInRange(-5.25f, 5.25f);
+        float z = generateRandomNumInRange(-5.25f, 5.25f);
+        float angle = generateRandomNumInRange(0.0f, 180.0f);
+        creatures.kelp.add(x, 0.0f, z, glm::radians(angle));
     }
+    creatures.kelp.update();
 
-    // 75 fish 2s
-    std::vector<Model> fish2Models;
-    for (int i = 0; i < 75; i++)
+    // 20 jellyfish 1s and 20 jellyfish 2s, bobbing out of phase
+    for (JellyfishArchetype* jellyfish : { &creatures.jellyfish1, &creatures.jellyfish2 })
     {
-        fish2Models.push_back(initModel(fish2Model, generateRandomNumInRange(-5.25f, 5.25f), generateRandomNumInRange(0.5f, 2.8f), generateRandomNumInRange(-5.25f, 5.25f),
-            0.0f, glm::radians(generateRandomNumInRange(175.0f, 185.0f)), 0.0f));
-        fish2Models[i].meshes[0].initRad = std::sqrtf(std::powf(fish2Models[i].meshes[0].mesh6DoF[tX], 2.0f) + std::powf(fish2Models[i].meshes[0].mesh6DoF[tZ], 2.0f));
-        fish2Models[i].meshes[0].initRot = fish2Models[i].meshes[0].mesh6DoF[rY];
+        jellyfish->reserve(20);
+        for (int i = 0; i < 20; i++)
+        {
+            float x = generateRandomNumInRange(-5.25f, 5.25f);
+            float y = generateRandomNumInRange(0.5f, 2.5f);
+            float z = generateRandomNumInRange(-5.25f, 5.25f);
+            float angle = generateRandomNumInRange(0.0f, 180.0f);
+            jellyfish->add(x, y, z, glm::radians(angle), -0.5f * i);
+        }
     }
 
-    // 15 rocks
-    std::vector<Model> rockModels;
+    // Shark
+    float sharkY = generateRandomNumInRange(1.0f, 2.0f);
+    float sharkAngle = generateRandomNumInRange(175.0f, 185.0f);
+    creatures.shark.add(4.5f, sharkY, 4.5f, glm::radians(sharkAngle));
+
+    // 75 fish 1s and 75 fish 2s (or --fish of each), spread around their orbits
+    for (FishArchetype* fish : { &creatures.fish1, &creatures.fish2 })
+    {
+        fish->reserve(numFish);
+        for (unsigned int i = 0; i < numFish; i++)
+        {
+            float x = generateRandomNumInRange(-5.25f, 5.25f);
+            float y = generateRandomNumInRange(0.5f, 2.8f);
+            float z = generateRandomNumInRange(-5.25f, 5.25f);
+            float angle = generateRandomNumInRange(175.0f, 185.0f);
+            fish->add(x, y, z, glm::radians(angle), 1.0f * i);
+        }
+    }
+
+    // 15 rocks, posed once
+    creatures.rocks.reserve(15);
     for (int i = 0; i < 15; i++)
-        rockModels.push_back(initModel(rockModel, generateRandomNumInRange(-5.0f, 5.0f), 0.0f, generateRandomNumInRange(-5.0f, 5.0f),
-            0.0f, glm::radians(generateRandomNumInRange(0.0f, 180.0f)), 0.0f));
+    {
+        float x = generateRandomNumInRange(-5.0f, 5.0f);
+        float z = generateRandomNumInRange(-5.0f, 5.0f);
+        float angle = generateRandomNumInRange(0.0f, 180.0f);
+        creatures.rocks.add(x, 0.0f, z, glm::radians(angle));
+    }
+    creatures.rocks.buildWorldMatrices();
+    phaseStart = StartupTrace::instance().endPhase("populations", phaseStart);
+
+    // Instanced batches for the populations (one draw call per mesh per frame)
+    InstancedModel fish1Batch(fish1Model, creatures.fish1.size());
+    InstancedModel fish2Batch(fish2Model, creatures.fish2.size());
+    InstancedModel jellyfish1Batch(jellyfishModel, creatures.jellyfish1.size());
+    InstancedModel jellyfish2Batch(jellyfish2Model, creatures.jellyfish2.size());
+    InstancedModel rockBatch(rockModel, creatures.rocks.size());
+
+    // Orbit constants of each fish for the GPU swim animation, uploaded once
+    SwimBatch fish1SwimBatch(fish1Model, creatures.fish1.getSwimInstances());
+    SwimBatch fish2SwimBatch(fish2Model, creatures.fish2.getSwimInstances());
+
+    // Fish school around the tank, steering clear of the rocks
+    BoidSchool fish1School(creatures.fish1);
+    BoidSchool fish2School(creatures.fish2);
+    for (unsigned int i = 0; i < creatures.rocks.size(); i++)
+    {
+        glm::vec3 rockCenter(creatures.rocks.x[i], creatures.rocks.y[i], creatures.rocks.z[i]);
+        fish1School.addObstacle(rockCenter, rockModel.getBoundingRadius());
+        fish2School.addObstacle(rockCenter, rockModel.getBoundingRadius());
+    }
+
+    // Food pellets from a fixed pool, the shark (and the schooling fish) going for the nearest one
+    FeedingSystem feeding;
+    feeding.addSharks(creatures.shark);
+    if (!gpuFishAnimation)
+    {
+        feeding.addSchool(fish1School);
+        feeding.addSchool(fish2School);
+    }
+
+    // Pellets drawn as GPU particles, flakes sinking with their pellet
+    ParticleBehavior flakeBehavior;
+    flakeBehavior.wobbleAmplitude = 0.02f;
+    flakeBehavior.wobbleFrequency = 2.0f;
+    flakeBehavior.floorHeight = feeding.params.floorHeight;
+    ParticleSystem foodFlakes(feeding.params.capacity * FLAKES_PER_PELLET, flakeBehavior);
+    std::mt19937 flakeRandom(4321);
+
+    // Kelp segments merged into one mesh and swayed in the vertex shader, one draw for all stalks
+    KelpBatch kelpBatch(kelpModel);
+    for (unsigned int i = 0; i < creatures.kelp.size(); i++)
+        kelpBatch.addStalk(creatures.kelp.getWorldMatrix(i));
 
     // Set wall constrains
     std::vector<glm::vec3> wallVertices = {};
     for (const Mesh& mesh: wallModel.meshes)
     {
-        for (const Vertex& vertex: mesh.vertices)
+        for (const Vertex& vertex: mesh.data->vertices)
             wallVertices.push_back(vertex.Position);
     }
     camera.setWallConstrains(getWallConstraints(wallVertices));
 
+    // A stream of bubbles rising from the volcano to the surface, run entirely on the GPU
+    ParticleBehavior bubbleBehavior;
+    bubbleBehavior.acceleration = glm::vec3(0.0f, 0.15f, 0.0f);
+    bubbleBehavior.drag = 0.3f;
+    bubbleBehavior.wobbleAmplitude = 0.05f;
+    bubbleBehavior.wobbleFrequency = 3.0f;
+    bubbleBehavior.ceilingHeight = 3.0f;
+    bubbleBehavior.respawn = true;
+    bubbleBehavior.emitterPosition = getModelTop(volcanoModel, 0.05f);
+    bubbleBehavior.emitterRadius = 0.08f;
+    bubbleBehavior.emitVelocity = glm::vec3(0.0f, 0.25f, 0.0f);
+    bubbleBehavior.emitVelocitySpread = 0.05f;
+    bubbleBehavior.lifetimeRange = glm::vec2(4.0f, 12.0f);
+    bubbleBehavior.sizeRange = glm::vec2(0.008f, 0.025f);
+    ParticleSystem bubbles(numBubbles, bubbleBehavior);
+    phaseStart = StartupTrace::instance().endPhase("batches and systems", phaseStart);
+
+    // Derived data has been computed, CPU geometry no longer needed
+    for (Model* prototype : { &floorModel, &wallModel, &roofModel, &fishTankModel, &roofLampModel, &kelpModel, &jellyfishModel,
+        &jellyfish2Model, &dirtFloorModel, &rockModel, &fish1Model, &fish2Model, &volcanoModel, &sharkModel,
+        &paintingModel, &tablesModel })
+        prototype->releaseGeometry();
+
     // Fine tune camera params
     camera.setMouseSensitivity(mouseSensitivity);
     camera.setCameraMovementSpeed(cameraSpeed);
@@ -272,8 +571,14 @@ int main()
     camera.setFPSCamera(true, yPos);
     camera.setZoomEnabled(false);
 
+    // Shared uniform blocks
+    bindSharedUniformBlocks(shader);
+    bindSharedUniformBlocks(particleShader);
+    UniformBuffer<FrameUniforms> frameUBO(FRAME_UNIFORMS_BINDING);
+    UniformBuffer<LightsUniforms> lightsUBO(LIGHTS_BINDING);
+
     // Point light locations
-    glm::vec3 lightPositions[5] =
+    glm::vec3 lightPositions[NUM_POINT_LIGHTS] =
     {
         glm::vec3(0.0f, 3.0f, 0.0f),
         glm::vec3(-3.0f, 3.0f, -3.0f),
@@ -282,310 +587,338 @@ int main()
         glm::vec3(3.0f, 3.0f, 3.0f),
     };
 
-    shader.use();
-
     // Lights in tank
-    for (int i = 0; i < 5; i++)
+    LightsUniforms lights;
+    for (unsigned int i = 0; i < NUM_POINT_LIGHTS; i++)
     {
-        shader.setVec3("pointLights[" + std::to_string(i) + "].position", lightPositions[i]);
-        shader.setVec3("pointLights[" + std::to_string(i) + "].ambient", glm::vec3(0.1f, 0.2f, 0.4f)); 
-        shader.setVec3("pointLights[" + std::to_string(i) + "].diffuse", glm::vec3(0.8f, 0.8f, 0.8f)); 
-        shader.setVec3("pointLights[" + std::to_string(i) + "].specular", glm::vec3(0.5f, 0.5f, 0.5f));
-        shader.setFloat("pointLights[" + std::to_string(i) + "].constant", 0.9f);
-        shader.setFloat("pointLights[" + std::to_string(i) + "].linear", 0.04f);
-        shader.setFloat("pointLights[" + std::to_string(i) + "].quadratic", 0.01f);
+        lights.pointLights[i].position = lightPositions[i];
+        lights.pointLights[i].ambient = glm::vec3(0.1f, 0.2f, 0.4f);
+        lights.pointLights[i].diffuse = glm::vec3(0.8f, 0.8f, 0.8f);
+        lights.pointLights[i].specular = glm::vec3(0.5f, 0.5f, 0.5f);
+        lights.pointLights[i].constant = 0.9f;
+        lights.pointLights[i].linear = 0.04f;
+        lights.pointLights[i].quadratic = 0.01f;
     }
+    FrameUniforms frameUniforms;
+
+    shader.use();
 
     // Set specular exponent
     shader.setFloat("specularExponent", 32.0f);
 
-    // Render loop
-    float elapsedTime = 0.0f;
-    while (!glfwWindowShouldClose(window))
-    {
-        // Per-frame time logic
-        float currentFrame = static_cast<float>(glfwGetTime());
-        deltaTime = currentFrame - prevFrame;
-        elapsedTime += deltaTime;
-        prevFrame = currentFrame;
+    // Samplers read from fixed texture units, a mesh binds its i-th texture to unit i
+    for (int i = 0; i < 4; i++)
+        shader.setInt("textureDiffuse" + std::to_string(i + 1), i);
 
-        // User input handling
-        processUserInput(window);
+    // Uniform handles used in the render loop (resolved once, no lookups per draw)
+    Uniform<glm::mat4> modelUniform = shader.uniform<glm::mat4>("model");
+    Uniform<bool> useTextureUniform = shader.uniform<bool>("useTexture");
+    Uniform<glm::vec4> glassColorUniform = shader.uniform<glm::vec4>("glassColor");
 
-        // Clear screen colour and buffers
-        glClearColor(0.2f, 0.5f, 0.8f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // Rejects meshes outside the view frustum before drawing
+    FrustumCuller culler;
 
-        // Enable blending
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    // Threads for the creature updates
+    JobSystem jobs(numUpdateThreads);
+    std::cout << "Creature updates on " << jobs.size() << " threads" << std::endl;
 
-        // Enable shader before setting uniforms
-        shader.use();
-        shader.setBool("useTexture", GL_TRUE);
+    // Simulation runs at a fixed rate, drawing interpolates between its steps
+    SimulationClock simulationClock(simulationRate);
 
-        // Camera position
-        shader.setVec3("viewPositon", camera.position);
+    // Frame profile overlay
+    HudOverlay hud;
+    phaseStart = StartupTrace::instance().endPhase("render state", phaseStart);
 
-        // Model, View & Projection transformations, set uniforms in shader
-        glm::mat4 model = glm::identity<glm::mat4>();
-        shader.setMat4("model", model);
-        glm::mat4 view = camera.getViewMatrix();
-        shader.setMat4("view", view);
-        glm::mat4 projection = glm::perspective(glm::radians(camera.zoom), static_cast<float>(SCREEN_WIDTH) / static_cast<float>(SCREEN_HEIGHT), 0.1f, 100.0f);
-        shader.setMat4("projection", projection);
-
-        // Fish food animation (if clicked)
-        if (fishFoodAnimStarted)
-        {
-            if (!fishFoodInit)
-            {
-                fishFoodModel = initModel(fishFoodModel, 4.0f, 2.5f, 4.0f, 0.0f, 0.0f, 0.0f);
-                for (unsigned int i = 1; i < static_cast<unsigned int>(fishFoodModel.meshes.size()); i++)
-                {
-                    fishFoodModel.meshes[i].mesh6DoF[tX] = fishFoodModel.meshes[0].mesh6DoF[tX];
-                    fishFoodModel.meshes[i].mesh6DoF[tY] = fishFoodModel.meshes[0].mesh6DoF[tY];
-                    fishFoodModel.meshes[i].mesh6DoF[tZ] = fishFoodModel.meshes[0].mesh6DoF[tZ];
-                    fishFoodModel.meshes[i].mesh6DoF[rX] = fishFoodModel.meshes[0].mesh6DoF[rX];
-                    fishFoodModel.meshes[i].mesh6DoF[rY] = fishFoodModel.meshes[0].mesh6DoF[rY];
-                    fishFoodModel.meshes[i].mesh6DoF[rZ] = fishFoodModel.meshes[0].mesh6DoF[rZ];
-                    fishFoodModel.meshes[i].updateModelMatrix();
-                }
-                fishFoodInit = true;
+    // Startup is over, write its timeline
+    StartupTrace::instance().addSpan("startup", "startup", startupStart, phaseStart);
+    if (!tracePath.empty())
+        StartupTrace::instance().write(tracePath);
 
-                model = fishFoodModel.meshes[0].meshMatrix;
-                shader.setMat4("model", model);
-                fishFoodModel.draw(shader);
-            }
+    // Headless runs a fixed number of frames, each advancing the scene by the same time so runs do the same work
+    // (a replay or tour runs until it ends instead)
+    FrameTimeStats frameTimeStats;
+    unsigned int frame = 0;
+    unsigned int tourFrame = 0;
+    bool scripted = replaying || touring;
+
+    // Render loop
+    while (headless ? scripted || frame < numWarmupFrames + numFrames : !glfwWindowShouldClose(window))
+    {
+        std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+        Profiler::instance().beginFrame();
+        GLCounters::beginFrame();
+
+        // This frame's input: from the replay log, from the tour, or live
+        InputFrame input;
+        if (replaying)
+        {
+            if (!inputReplay.next(input))
+                break;
+        }
+        else if (touring)
+        {
+            float tourTime = ++tourFrame * TOUR_FRAME_SECONDS;
+            if (tourTime > cameraTour.getDuration() + 0.5f * TOUR_FRAME_SECONDS)
+                break;
+            input = cameraTour.getFrame(tourTime, TOUR_FRAME_SECONDS);
+        }
+        else
+        {
+            // Per-frame time logic
+            unsigned int previousDropRequests = fishFoodDropRequests;
+            if (headless)
+                deltaTime = 1.0f / 60.0f;
             else
             {
-                for (unsigned int i = 0; i < static_cast<unsigned int>(fishFoodModel.meshes.size()); i++)
-                {
-                    // Check when to end animation
-                    if ((fishFoodModel.meshes[i].mesh6DoF[tY] - elapsedTime * 0.0001f) < 0.0f)
-                    {
-                        fishFoodAnimStarted = false;
-                        fishFoodInit = false;
-                    }
+                float currentFrame = static_cast<float>(glfwGetTime());
+                deltaTime = currentFrame - prevFrame;
+                prevFrame = currentFrame;
 
-                    fishFoodModel.meshes[i].mesh6DoF[tY] -= elapsedTime * 0.00002f;
-                    fishFoodModel.meshes[i].updateModelMatrix();
+                // User input handling
+                processUserInput(window);
+            }
+            input.deltaTime = deltaTime;
+            input.cameraPosition = camera.position;
+            input.cameraYaw = camera.yaw;
+            input.cameraPitch = camera.pitch;
+            input.cameraZoom = camera.zoom;
+            input.foodDrops = fishFoodDropRequests - previousDropRequests;
+        }
 
-                    model = fishFoodModel.meshes[i].meshMatrix;
-                    shader.setMat4("model", model);
-                    fishFoodModel.meshes[i].draw(shader);
-                }
+        // Scripted input drives the camera and the food, only Escape still works
+        if (scripted)
+        {
+            deltaTime = input.deltaTime;
+            camera.setPose(input.cameraPosition, input.cameraYaw, input.cameraPitch);
+            camera.setZoom(input.cameraZoom);
+            fishFoodDropRequests += input.foodDrops;
+            if (window && glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+                glfwSetWindowShouldClose(window, true);
+        }
+        if (inputRecorder.isOpen())
+            inputRecorder.record(input);
 
-                // Draw shark
-                for (unsigned int j = 0; j < static_cast<unsigned int>(sharkModel.meshes.size()); j++)
+        // Simulation steps: creature arrays and food state only, no GL, the large populations spread across the job system
+        simulationClock.addFrameTime(deltaTime);
+        unsigned int stepsThisFrame = 0;
+        float renderTime, alpha;
+        {
+            PROFILE_CPU_ZONE("update");
+            while (simulationClock.step())
+            {
+                stepsThisFrame++;
+                float simTime = simulationClock.getTime();
+                float stepSeconds = simulationClock.getStepSeconds();
+                creatures.update(simTime, stepSeconds, jobs, false);
+                if (!gpuFishAnimation)
                 {
-                    // Update shark pose params
-                    glm::vec3 directionVec(fishFoodModel.meshes[0].mesh6DoF[tX] - sharkModel.meshes[0].mesh6DoF[tX],
-                        fishFoodModel.meshes[0].mesh6DoF[tY] - sharkModel.meshes[0].mesh6DoF[tY],
-                        fishFoodModel.meshes[0].mesh6DoF[tZ] - sharkModel.meshes[0].mesh6DoF[tZ]);
+                    fish1School.step(stepSeconds, jobs);
+                    fish2School.step(stepSeconds, jobs);
+                }
 
-                    float magnitude = std::sqrtf(std::powf(directionVec[0], 2.0f) + std::powf(directionVec[1], 2.0f) + std::powf(directionVec[2], 2.0f));
+                // Fish food drops in above the tank and sinks to the floor, the shark chases the nearest pellet
+                // (circling when there is none) and fish nearby pick pellets off
+                for (; fishFoodDropRequests > 0; fishFoodDropRequests--)
+                    feeding.drop();
+                feeding.step(simTime, stepSeconds, jobs);
+            }
 
-                    // Check if shark has got to food to end animation
-                    if (magnitude < 0.1f)
-                    {
-                        fishFoodAnimStarted = false;
-                        fishFoodInit = false;
-                        sharkModel.meshes[0].initRad = std::sqrtf(std::powf(sharkModel.meshes[0].mesh6DoF[tX], 2.0f) + std::powf(sharkModel.meshes[0].mesh6DoF[tZ], 2.0f));
-                        break;
-                    }
+            // World matrices for this frame, between the last two steps
+            renderTime = simulationClock.getRenderTime();
+            alpha = simulationClock.getAlpha();
+            creatures.buildMatrices(renderTime, alpha, jobs, !gpuFishAnimation);
+            creatures.shark.buildMatrices(renderTime, alpha);
+        }
 
-                    // Normalize to unit vec
-                    directionVec /= magnitude;
+        // Particles take the same steps on the GPU, new pellets' flakes start where their pellet is now
+        float stepSeconds = simulationClock.getStepSeconds();
+        {
+            PROFILE_ZONE("particle update");
+            emitFoodFlakes(foodFlakes, feeding, flakeRandom);
+            foodFlakes.setOwnerGenerations(feeding.getGenerations(), feeding.params.capacity);
+            foodFlakes.update(particleUpdateShader, simulationClock.getTime(), stepSeconds, stepsThisFrame);
+            bubbles.update(particleUpdateShader, simulationClock.getTime(), stepSeconds, stepsThisFrame);
+        }
 
-                    sharkModel.meshes[0].mesh6DoF[tX] += directionVec[0] * 0.005f;
-                    sharkModel.meshes[0].mesh6DoF[tY] += directionVec[1] * 0.005f;
-                    sharkModel.meshes[0].mesh6DoF[tZ] += directionVec[2] * 0.005f;
+        // Clear screen colour and buffers
+        glClearColor(0.2f, 0.5f, 0.8f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-                    // Slowly rotate towards target
-                    float target = std::atan2f(directionVec[2], directionVec[0]) + float(M_PI);
-                    if ((target - sharkModel.meshes[0].mesh6DoF[rY]) < 0.0f)
-                        sharkModel.meshes[0].mesh6DoF[rY] -= 0.001f;
-                    else
-                        sharkModel.meshes[0].mesh6DoF[rY] += 0.001f;
+        // Enable blending
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
+        // Enable shader before setting uniforms
+        shader.use();
+        useTextureUniform.set(true);
+
+        // View & Projection transformations and camera position, written to the shared block if changed
+        frameUniforms.view = camera.getViewMatrix();
+        frameUniforms.projection = glm::perspective(glm::radians(camera.zoom), static_cast<float>(SCREEN_WIDTH) / static_cast<float>(SCREEN_HEIGHT), 0.1f, 100.0f);
+        frameUniforms.viewPosition = camera.position;
+        frameUniforms.time = renderTime;
+        frameUBO.update(frameUniforms);
+        lightsUBO.update(lights);
+        culler.update(frameUniforms.projection * frameUniforms.view);
+
+        // Model transformation
+        glm::mat4 model = glm::identity<glm::mat4>();
+        modelUniform.set(model);
 
-                    for (unsigned int j = 0; j < static_cast<unsigned int>(sharkModel.meshes.size()); j++)
+        // Draw shark
+        {
+            PROFILE_ZONE("shark");
+            for (unsigned int i = 0; i < creatures.shark.size(); i++)
+            {
+                for (unsigned int j = 0; j < static_cast<unsigned int>(sharkModel.meshes.size()); j++)
+                {
+                    const glm::mat4& sharkMatrix = creatures.shark.getWorldMatrix(i, j);
+                    if (culler.isMeshVisible(*sharkModel.meshes[j].data, sharkMatrix))
                     {
-                        sharkModel.meshes[j].mesh6DoF[rY] = sharkModel.meshes[0].mesh6DoF[rY] + 0.1f * sin(elapsedTime * 5.0f + j * 5.0f);
-                        sharkModel.meshes[j].updateModelMatrix();
-
-                        // Set model matrix (multiply with previous model matrix for hierarchy animation)
-                        model = sharkModel.meshes[j].meshMatrix;
-                        shader.setMat4("model", model);
+                        modelUniform.set(sharkMatrix);
                         sharkModel.meshes[j].draw(shader);
-
-                        // Remove "wagging" for next loop
-                        sharkModel.meshes[j].mesh6DoF[rY] -= 0.1f * sin(elapsedTime * 5.0f + j * 5.0f);
                     }
                 }
             }
         }
-        else
+
+        // Draw fish, orbits posed on the GPU
         {
-            // Draw shark
-            for (unsigned int j = 0; j < static_cast<unsigned int>(sharkModel.meshes.size()); j++)
+            PROFILE_ZONE("fish");
+            if (gpuFishAnimation)
             {
-                // Update shark pose params
-                float sharkRad = sharkModel.meshes[0].initRad;
-                float theta = elapsedTime * 0.1f;
-                sharkModel.meshes[0].mesh6DoF[tX] = sharkRad * cos(theta);
-                sharkModel.meshes[0].mesh6DoF[tZ] = sharkRad * sin(theta);
-                sharkModel.meshes[0].mesh6DoF[rY] = (float(M_PI) / 2.0f) - theta + float(M_PI);
-
-                for (unsigned int j = 0; j < static_cast<unsigned int>(sharkModel.meshes.size()); j++)
-                {
-                    sharkModel.meshes[j].mesh6DoF[rY] = sharkModel.meshes[0].mesh6DoF[rY] + 0.1f * sin(elapsedTime * 5.0f + j * 5.0f);
-                    sharkModel.meshes[j].updateModelMatrix();
-
-                    // Set model matrix (multiply with previous model matrix for hierarchy animation)
-                    model = sharkModel.meshes[j].meshMatrix;
-                    shader.setMat4("model", model);
-                    sharkModel.meshes[j].draw(shader);
-                }
+                fish1SwimBatch.draw(shader);
+                fish2SwimBatch.draw(shader);
+            }
+            // Or schooling, posed on the CPU and culled
+            else
+            {
+                addVisibleInstances(fish1Batch, fish1Model, creatures.fish1, culler);
+                addVisibleInstances(fish2Batch, fish2Model, creatures.fish2, culler);
+                fish1Batch.draw(shader);
+                fish2Batch.draw(shader);
             }
         }
 
-        // Draw fish 1s
-        model = glm::mat4(1);
-        for (unsigned int i = 0; i < static_cast<unsigned int>(fish1Models.size()); i++)
+        // Draw jellyfish
         {
-            // Update fish pose params
-            float fishRad = fish1Models[i].meshes[0].initRad;
-            float theta = elapsedTime * 0.1f + 1.0 * i;
-            fish1Models[i].meshes[0].mesh6DoF[tX] = fishRad * cos(theta);
-            fish1Models[i].meshes[0].mesh6DoF[tZ] = fishRad * sin(theta);
-            fish1Models[i].meshes[0].mesh6DoF[rY] = (float(M_PI) / 2.0f) - theta + float(M_PI);
-
-            for (unsigned int j = 0; j < static_cast<unsigned int>(fish1Models[i].meshes.size()); j++)
-            {
-                fish1Models[i].meshes[j].mesh6DoF[rY] = fish1Models[i].meshes[0].mesh6DoF[rY] + 0.1f * sin(elapsedTime * 5.0f + j * 5.0f);
-                fish1Models[i].meshes[j].updateModelMatrix();
-
-                // Set model matrix (multiply with previous model matrix for hierarchy animation)
-                model = fish1Models[i].meshes[j].meshMatrix;
-                shader.setMat4("model", model);
-                fish1Models[i].meshes[j].draw(shader);
-            }
+            PROFILE_ZONE("jellyfish");
+            addVisibleInstances(jellyfish1Batch, jellyfishModel, creatures.jellyfish1, culler);
+            addVisibleInstances(jellyfish2Batch, jellyfish2Model, creatures.jellyfish2, culler);
+            jellyfish1Batch.draw(shader);
+            jellyfish2Batch.draw(shader);
+        }
 
-            // Reset kelp hierarchy matrix for next kelp model
-            model = glm::mat4(1);
+        // Draw kelp
+        {
+            PROFILE_ZONE("kelp");
+            kelpBatch.draw(shader, culler);
         }
 
-        // Draw fish 2s
-        model = glm::mat4(1);
-        for (unsigned int i = 0; i < static_cast<unsigned int>(fish2Models.size()); i++)
         {
-            // Update fish pose params
-            float fishRad = fish2Models[i].meshes[0].initRad;
-            float theta = elapsedTime * 0.1f + 1.0 * i;
-            fish2Models[i].meshes[0].mesh6DoF[tX] = fishRad * cos(theta);
-            fish2Models[i].meshes[0].mesh6DoF[tZ] = fishRad * sin(theta);
-            fish2Models[i].meshes[0].mesh6DoF[rY] = (float(M_PI) / 2.0f) - theta + float(M_PI);
-
-            for (unsigned int j = 0; j < static_cast<unsigned int>(fish2Models[i].meshes.size()); j++)
-            {
-                fish2Models[i].meshes[j].mesh6DoF[rY] = fish2Models[i].meshes[0].mesh6DoF[rY] + 0.1f * sin(elapsedTime * 5.0f + j * 5.0f);
-                fish2Models[i].meshes[j].updateModelMatrix();
+            PROFILE_ZONE("static scene");
 
-                // Set model matrix (multiply with previous model matrix for hierarchy animation)
-                model = fish2Models[i].meshes[j].meshMatrix;
-                shader.setMat4("model", model);
-                fish2Models[i].meshes[j].draw(shader);
-            }
+            // Draw rocks
+            addVisibleInstances(rockBatch, rockModel, creatures.rocks, culler);
+            rockBatch.draw(shader);
 
-            // Reset kelp hierarchy matrix for next kelp model
+            // Reset model matrix to identity
             model = glm::mat4(1);
+            modelUniform.set(model);
+
+            // Draw
+            culler.drawModel(floorModel, shader, model);
+            culler.drawModel(wallModel, shader, model);
+            culler.drawModel(tablesModel, shader, model);
+            culler.drawModel(roofLampModel, shader, model);
+            culler.drawModel(roofModel, shader, model);
+            culler.drawModel(dirtFloorModel, shader, model);
+            culler.drawModel(volcanoModel, shader, model);
+            culler.drawModel(paintingModel, shader, model);
         }
 
-        // Draw jellyfish 1s
-        for (unsigned int i = 0; i < static_cast<unsigned int>(jellyfish1Models.size()); i++)
+        float renderLag = (1.0f - alpha) * stepSeconds;
         {
-            // Update jellyfish pose params
-            jellyfish1Models[i].meshes[0].mesh6DoF[tY] = 0.5f * sin(elapsedTime * 0.5f - i * 0.5f) + 1.5f;
-            jellyfish1Models[i].meshes[0].mesh6DoF[rY] += glm::radians(0.3f);
-            jellyfish1Models[i].meshes[0].updateModelMatrix();
-
-            // Set model matrix
-            model = jellyfish1Models[i].meshes[0].meshMatrix;
-            shader.setMat4("model", model);
-            jellyfish1Models[i].draw(shader);
+            PROFILE_ZONE("particles");
+
+            // Draw fish food flakes
+            foodFlakes.draw(particleShader, renderLag, glm::vec4(0.55f, 0.35f, 0.15f, 1.0f), false);
+
+            glDepthMask(GL_FALSE);  // Disable depth writes for bubbles and glass
+
+            // Draw bubbles
+            bubbles.draw(particleShader, renderLag, glm::vec4(0.85f, 0.95f, 1.0f, 0.6f), true);
+            shader.use();
         }
 
-        // Draw jellyfish 2s
-        for (unsigned int i = 0; i < static_cast<unsigned int>(jellyfish2Models.size()); i++)
         {
-            // Update jellyfish pose params
-            jellyfish2Models[i].meshes[0].mesh6DoF[tY] = 0.5f * sin(elapsedTime * 0.5f - i * 0.5f) + 1.5f;
-            jellyfish2Models[i].meshes[0].mesh6DoF[rY] += glm::radians(0.3f);
-            jellyfish2Models[i].meshes[0].updateModelMatrix();
-
-            // Set model matrix
-            model = jellyfish2Models[i].meshes[0].meshMatrix;
-            shader.setMat4("model", model);
-            jellyfish2Models[i].draw(shader);
+            PROFILE_ZONE("glass");
+            useTextureUniform.set(false);
+            glassColorUniform.set(glm::vec4(0.8f, 0.8f, 0.9f, 0.2f)); // Glass, 20% transparent, light blue
+            culler.drawModel(fishTankModel, shader, model);
+            glDepthMask(GL_TRUE);   // Enable depth writes after glass
         }
 
-        // Draw kelp
-        model = glm::mat4(1);
-        for (unsigned int i = 0; i < static_cast<unsigned int>(kelpModels.size()); i++)
-        {
-            for (unsigned int j = 0; j < static_cast<unsigned int>(kelpModels[i].meshes.size()); j++)
-            {
-                // Update jellyfish pose params
-                kelpModels[i].meshes[j].mesh6DoF[rZ] = 0.05f * sin(elapsedTime * 0.75f + j * 0.5f);
-                kelpModels[i].meshes[j].updateModelMatrix();
-
-                // Set model matrix (multiply with previous model matrix for hierarchy animation)
-                model *= kelpModels[i].meshes[j].meshMatrix;
-                shader.setMat4("model", model);
-                kelpModels[i].meshes[j].draw(shader);
-            }
+        // GL calls of the scene (the overlay's own are left out)
+        FrameGLCounters sceneCounters = GLCounters::getFrame();
+        const CullingStats& cullingStats = culler.getStats();
+        if (glCounterLog.isOpen())
+            glCounterLog.write(sceneCounters, cullingStats);
 
-            // Reset kelp hierarchy matrix for next kelp model
-            model = glm::mat4(1);
+        // Frame profile and GL calls, drawn over the scene when asked for (H)
+        Profiler::instance().endFrame();
+        if (showProfilerHud)
+        {
+            hud.clear();
+            if (Profiler::instance().getZones().empty())
+                hud.addText(20.0f, 20.0f, "PROFILER OFF: BUILD WITH MY_PROFILER", glm::vec4(1.0f, 1.0f, 0.4f, 1.0f));
+            else
+                Profiler::instance().addToHud(hud, 20.0f, 20.0f);
+            addGLCountersToHud(hud, sceneCounters, cullingStats, SCREEN_WIDTH - HudOverlay::getCharacterAdvance() * 28.0f - 20.0f, 20.0f);
+            hud.draw(SCREEN_WIDTH, SCREEN_HEIGHT);
         }
 
-        // Draw rocks
-        for (unsigned int i = 0; i < static_cast<unsigned int>(rockModels.size()); i++)
+        // Wait for the GPU so the frame time covers all of its work
+        if (headless)
         {
-            model = rockModels[i].meshes[0].meshMatrix;
-            shader.setMat4("model", model);
-            rockModels[i].draw(shader);
+            glFinish();
+            if (frame >= numWarmupFrames)
+                frameTimeStats.add(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count(), sceneCounters, cullingStats);
+            frame++;
+            continue;
         }
 
-        // Reset model matrix to identity
-        model = glm::mat4(1);
-        shader.setMat4("model", model);
-
-        // Draw
-        floorModel.draw(shader);
-        wallModel.draw(shader);
-        tablesModel.draw(shader);
-        roofLampModel.draw(shader);
-        roofModel.draw(shader);
-        dirtFloorModel.draw(shader);
-        volcanoModel.draw(shader);
-        paintingModel.draw(shader);
-
-        glDepthMask(GL_FALSE);  // Disable depth writes for glass
-        shader.setBool("useTexture", GL_FALSE);
-        shader.setVec4("glassColor", glm::vec4(0.8f, 0.8f, 0.9f, 0.2f)); // Glass, 20% transparent, light blue
-        fishTankModel.draw(shader);
-        glDepthMask(GL_TRUE);   // Enable depth writes after glass
-
         // Swap buffers and poll events
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
+    if (headless)
+    {
+        std::cout << "Headless " << SCREEN_WIDTH << "x" << SCREEN_HEIGHT << ", " << numWarmupFrames << " warm-up frames" << std::endl;
+        frameTimeStats.print(std::cout);
+        if (!screenshotPath.empty() && offscreenTarget->savePPM(screenshotPath.c_str()))
+            std::cout << "Last frame written to " << screenshotPath << std::endl;
+        if (!statsPath.empty() && frameTimeStats.writeJson(statsPath, reinterpret_cast<const char*>(glGetString(GL_RENDERER)), SCREEN_WIDTH, SCREEN_HEIGHT))
+            std::cout << "Frame stats written to " << statsPath << std::endl;
+    }
+
+    Profiler::instance().print(std::cout);
+    inputRecorder.close();
+    if (!recordPath.empty())
+        std::cout << "Input recorded to " << recordPath << std::endl;
+    if (glCounterLog.isOpen())
+        std::cout << "GL calls per frame written to " << glLogPath << std::endl;
+
+    const FeedingStats& feedingStats = feeding.getStats();
+    std::cout << "Fish food: " << feedingStats.dropped << " pellets dropped (" << feedingStats.rejected << " with the tank full), "
+        << feedingStats.eatenBySharks << " eaten by sharks, " << feedingStats.eatenByFish << " by fish, "
+        << feedingStats.dissolved << " dissolved" << std::endl;
+
     // Terminate and return success
-    glfwTerminate();
+    TextureRegistry::instance().releaseContext();
+    if (!headless)
+        glfwTerminate();
     return 0;
 }
 
@@ -607,13 +940,17 @@ void processUserInput(GLFWwindow* window)
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
         camera.processKeyboardInput(GLFW_KEY_D, deltaTime);
 
-    // Fish food (F)
-    if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS)
-    {
-        // Can't keep spamming it
-        if (!fishFoodAnimStarted)
-            fishFoodAnimStarted = true;
-    }
+    // Fish food (F), one drop per press
+    bool fishFoodKeyPressed = glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS;
+    if (fishFoodKeyPressed && !fishFoodKeyDown)
+        fishFoodDropRequests++;
+    fishFoodKeyDown = fishFoodKeyPressed;
+
+    // Profiler overlay (H), toggled per press
+    bool profilerKeyPressed = glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS;
+    if (profilerKeyPressed && !profilerKeyDown)
+        showProfilerHud = !showProfilerHud;
+    profilerKeyDown = profilerKeyPressed;
 }
 
 // Window size change callback
@@ -0,0 +1,293 @@
+// End-to-end performance regression runner: renders a fixed set of scenarios with the aquarium's headless mode,
+// reads back each run's frame times and GL work (--stats), and compares them to a baseline JSON with per-metric
+// tolerances. Exits with 1 when a metric regressed beyond its tolerance, 2 when a run failed or has no baseline.
+// Metrics missing from a scenario's baseline are skipped: the checked in baseline only has the GL work (draw calls,
+// triangles), which is the same on every machine with --seed 1. Frame times only compare on the machine they were
+// recorded on, --update-baseline records every metric there.
+// Build it next to the main program, run it from the repository root.
+// Usage: perf_regression [--aquarium PATH] [--baseline FILE] [--update-baseline] [--frames N] [--size WxH] [--out DIR]
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// One scenario: a name and the aquarium options that make it
+struct Scenario
+{
+    const char* name;
+    const char* options;
+};
+
+const Scenario SCENARIOS[] =
+{
+    { "default", "" },                      // Demo scene from the start position
+    { "fish_x10", "--fish 750" },           // Ten times the schooling fish
+    { "feeding", "--tour feeding" },        // Food dropped four times a second for 20 seconds
+    { "tank", "--tour glass" },             // Up at the glass looking into the tank
+};
+
+// Metrics compared, and how much worse than the baseline each may get (fraction) unless the baseline file says otherwise
+const std::pair<const char*, double> DEFAULT_TOLERANCES[] =
+{
+    { "frame_ms_p50", 0.10 },
+    { "frame_ms_p95", 0.15 },
+    { "frame_ms_p99", 0.25 },
+    { "draw_calls_mean", 0.02 },
+    { "triangles_mean", 0.02 },
+};
+
+// Reads a JSON document of nested objects into "outer.inner" keys and their values as text (no arrays)
+class FlatJsonReader
+{
+public:
+    bool read(const std::string& path, std::map<std::string, std::string>& values)
+    {
+        std::ifstream in(path);
+        if (!in)
+            return false;
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        text = buffer.str();
+        position = 0;
+        this->values = &values;
+        if (!parseValue(std::string()))
+        {
+            std::cout << "ERROR::PERF::BAD_JSON " << path << " (at byte " << position << ")" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    std::string text;
+    size_t position = 0;
+    std::map<std::string, std::string>* values = nullptr;
+
+    void skipSpace()
+    {
+        while (position < text.size() && std::isspace(static_cast<unsigned char>(text[position])))
+            position++;
+    }
+
+    bool parseString(std::string& result)
+    {
+        if (position >= text.size() || text[position] != '"')
+            return false;
+        for (position++; position < text.size() && text[position] != '"'; position++)
+        {
+            if (text[position] == '\\')
+                position++;
+            result += text[position];
+        }
+        position++;
+        return position <= text.size();
+    }
+
+    bool parseValue(const std::string& key)
+    {
+        skipSpace();
+        if (position >= text.size())
+            return false;
+        if (text[position] == '{')
+        {
+            position++;
+            skipSpace();
+            while (position < text.size() && text[position] != '}')
+            {
+                std::string name;
+                if (!parseString(name))
+                    return false;
+                skipSpace();
+                if (position >= text.size() || text[position++] != ':')
+                    return false;
+                if (!parseValue(key.empty() ? name : key + "." + name))
+                    return false;
+                skipSpace();
+                if (position < text.size() && text[position] == ',')
+                {
+                    position++;
+                    skipSpace();
+                }
+            }
+            position++;
+            return position <= text.size();
+        }
+        std::string value;
+        if (text[position] == '"')
+        {
+            if (!parseString(value))
+                return false;
+        }
+        else
+        {
+            while (position < text.size() && text[position] != ',' && text[position] != '}' && !std::isspace(static_cast<unsigned char>(text[position])))
+                value += text[position++];
+            if (value.empty())
+                return false;
+        }
+        (*values)[key] = value;
+        return true;
+    }
+};
+
+// Check if any key starts with prefix
+bool hasPrefix(const std::map<std::string, std::string>& values, const std::string& prefix)
+{
+    std::map<std::string, std::string>::const_iterator found = values.lower_bound(prefix);
+    return found != values.end() && found->first.compare(0, prefix.size(), prefix) == 0;
+}
+
+// Number stored under key, or fallback if there is none
+double getNumber(const std::map<std::string, std::string>& values, const std::string& key, double fallback)
+{
+    std::map<std::string, std::string>::const_iterator found = values.find(key);
+    return found == values.end() ? fallback : std::atof(found->second.c_str());
+}
+
+// Write the tolerances and every scenario's measured metrics as a new baseline
+bool writeBaseline(const std::string& path, const std::map<std::string, double>& tolerances,
+    const std::map<std::string, std::map<std::string, std::string>>& measured)
+{
+    std::ofstream out(path);
+    if (!out)
+    {
+        std::cout << "ERROR::PERF::COULD_NOT_WRITE " << path << std::endl;
+        return false;
+    }
+    out << std::setprecision(10) << "{\n  \"tolerances\": {";
+    const char* separator = "\n";
+    for (const std::pair<const std::string, double>& tolerance : tolerances)
+    {
+        out << separator << "    \"" << tolerance.first << "\": " << tolerance.second;
+        separator = ",\n";
+    }
+    out << "\n  },\n  \"scenarios\": {";
+    separator = "\n";
+    for (const Scenario& scenario : SCENARIOS)
+    {
+        std::map<std::string, std::map<std::string, std::string>>::const_iterator run = measured.find(scenario.name);
+        if (run == measured.end())
+            continue;
+        out << separator << "    \"" << scenario.name << "\": {\n      \"renderer\": \"" << run->second.at("renderer") << "\"";
+        for (const std::pair<const std::string, double>& tolerance : tolerances)
+            out << ",\n      \"" << tolerance.first << "\": " << getNumber(run->second, tolerance.first, 0.0);
+        out << "\n    }";
+        separator = ",\n";
+    }
+    out << "\n  }\n}\n";
+    return true;
+}
+
+// Main function
+int main(int argc, char** argv)
+{
+    std::string aquariumPath = "./aquarium";
+    std::string baselinePath = "perf/baseline.json";
+    std::string outDirectory = ".";
+    std::string size = "1280x720";
+    unsigned int numFrames = 600;
+    bool updateBaseline = false;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--aquarium" && i + 1 < argc)
+            aquariumPath = argv[++i];
+        else if (arg == "--baseline" && i + 1 < argc)
+            baselinePath = argv[++i];
+        else if (arg == "--update-baseline")
+            updateBaseline = true;
+        else if (arg == "--frames" && i + 1 < argc)
+            numFrames = static_cast<unsigned int>(std::max(1, std::atoi(argv[++i])));
+        else if (arg == "--size" && i + 1 < argc)
+            size = argv[++i];
+        else if (arg == "--out" && i + 1 < argc)
+            outDirectory = argv[++i];
+        else
+        {
+            std::cout << "Unknown option " << arg << " (usage: --aquarium PATH --baseline FILE --update-baseline --frames N --size WxH --out DIR)" << std::endl;
+            return 2;
+        }
+    }
+
+    // Tolerances from the baseline, falling back to the defaults
+    std::map<std::string, std::string> baseline;
+    bool haveBaseline = FlatJsonReader().read(baselinePath, baseline);
+    if (!haveBaseline && !updateBaseline)
+        std::cout << "ERROR::PERF::NO_BASELINE " << baselinePath << " (record one with --update-baseline)" << std::endl;
+    std::map<std::string, double> tolerances;
+    for (const std::pair<const char*, double>& tolerance : DEFAULT_TOLERANCES)
+        tolerances[tolerance.first] = getNumber(baseline, std::string("tolerances.") + tolerance.first, tolerance.second);
+
+    // Same seed, size and frame count every run so runs do the same work
+    std::map<std::string, std::map<std::string, std::string>> measured;
+    bool failed = false, regressed = false;
+    for (const Scenario& scenario : SCENARIOS)
+    {
+        std::string statsPath = outDirectory + "/perf_" + scenario.name + ".json";
+        std::string logPath = outDirectory + "/perf_" + scenario.name + ".log";
+        std::string command = "\"" + aquariumPath + "\" --headless --seed 1 --size " + size + " --frames " + std::to_string(numFrames)
+            + " --warmup 60 --stats \"" + statsPath + "\" " + scenario.options + " > \"" + logPath + "\" 2>&1";
+        std::cout << "Running " << scenario.name << "..." << std::endl;
+
+        std::map<std::string, std::string> stats;
+        std::remove(statsPath.c_str());
+        if (std::system(command.c_str()) != 0 || !FlatJsonReader().read(statsPath, stats))
+        {
+            std::cout << "ERROR::PERF::RUN_FAILED " << scenario.name << " (see " << logPath << ")" << std::endl;
+            failed = true;
+            continue;
+        }
+        measured[scenario.name] = stats;
+        if (updateBaseline)
+            continue;
+
+        std::string prefix = std::string("scenarios.") + scenario.name + ".";
+        if (!hasPrefix(baseline, prefix))
+        {
+            std::cout << "  no baseline for " << scenario.name << std::endl;
+            failed = true;
+            continue;
+        }
+        if (baseline.count(prefix + "renderer") && baseline[prefix + "renderer"] != stats["renderer"])
+            std::cout << "  warning: baseline recorded on " << baseline[prefix + "renderer"] << ", running on " << stats["renderer"] << std::endl;
+
+        // Only getting worse counts, by more than the tolerance
+        for (const std::pair<const std::string, double>& tolerance : tolerances)
+        {
+            if (!baseline.count(prefix + tolerance.first))
+            {
+                std::cout << "  " << std::left << std::setw(18) << tolerance.first << std::right << "  not in baseline, skipped" << std::endl;
+                continue;
+            }
+            double expected = getNumber(baseline, prefix + tolerance.first, 0.0);
+            double actual = getNumber(stats, tolerance.first, 0.0);
+            double change = expected > 0.0 ? actual / expected - 1.0 : 0.0;
+            bool worse = change > tolerance.second;
+            regressed = regressed || worse;
+            std::cout << "  " << std::left << std::setw(18) << tolerance.first << std::right << std::fixed << std::setprecision(3)
+                << std::setw(14) << expected << std::setw(14) << actual << std::setw(9) << std::setprecision(1) << change * 100.0 << "%"
+                << (worse ? "  REGRESSION (tolerance " : "  ok (tolerance ") << tolerance.second * 100.0 << "%)" << std::endl;
+        }
+    }
+
+    if (updateBaseline)
+    {
+        if (failed || !writeBaseline(baselinePath, tolerances, measured))
+            return 2;
+        std::cout << "Baseline written to " << baselinePath << std::endl;
+        return 0;
+    }
+    if (regressed)
+        std::cout << "Performance regressed" << std::endl;
+    else if (!failed)
+        std::cout << "No regressions" << std::endl;
+    return regressed ? 1 : (failed ? 2 : 0);
+}
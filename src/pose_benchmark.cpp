@@ -0,0 +1,114 @@
+// Microbenchmark of pose to world matrix conversion: the per-mesh glm path against the batched kernel.
+// Build with -O2 and -mavx2 or /arch:AVX2 for the AVX2 path.
+#include <my_mesh.h>
+#include <my_pose_kernel.h>
+#include <my_timing.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// Previous Mesh::updateModelMatrix, a translate and three generic rotations
+glm::mat4 glmPoseToMatrix(const float pose[6])
+{
+    glm::mat4 matrix = glm::mat4(1.0f);
+    matrix = glm::translate(matrix, glm::vec3(pose[tX], pose[tY], pose[tZ]));
+    matrix = glm::rotate(matrix, pose[rX], glm::vec3(1.0f, 0.0f, 0.0f));
+    matrix = glm::rotate(matrix, pose[rY], glm::vec3(0.0f, 1.0f, 0.0f));
+    matrix = glm::rotate(matrix, pose[rZ], glm::vec3(0.0f, 0.0f, 1.0f));
+    return matrix;
+}
+
+// Largest absolute difference between two sets of matrices
+float maxError(const std::vector<glm::mat4>& a, const std::vector<glm::mat4>& b)
+{
+    float error = 0.0f;
+    for (unsigned int i = 0; i < static_cast<unsigned int>(a.size()); i++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            for (int r = 0; r < 4; r++)
+                error = std::max(error, std::fabs(a[i][c][r] - b[i][c][r]));
+        }
+    }
+    return error;
+}
+
+// Print one result row
+void printRow(const char* name, unsigned int count, double ms, double baselineMs, float error)
+{
+    std::cout << "  " << std::left << std::setw(28) << name << std::right
+        << std::setw(10) << std::fixed << std::setprecision(3) << ms << " ms"
+        << std::setw(9) << std::setprecision(1) << (ms > 0.0 ? count / ms / 1000.0 : 0.0) << " M/s"
+        << std::setw(8) << std::setprecision(2) << (ms > 0.0 ? baselineMs / ms : 0.0) << "x"
+        << "   max error " << std::scientific << std::setprecision(1) << error << std::defaultfloat << std::endl;
+}
+
+// Main function
+int main()
+{
+    const unsigned int counts[] = { 1000, 10000, 100000 };
+    const int repeats = 21;
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<float> translation(-5.0f, 5.0f);
+    std::uniform_real_distribution<float> angle(-3.14159265f, 3.14159265f);
+
+    std::cout << "Pose to matrix benchmark (best path compiled: " << getPoseKernelPathName(getBestPoseKernelPath()) << ")" << std::endl;
+    for (unsigned int count : counts)
+    {
+        // Same random poses as meshes and as arrays
+        std::vector<Mesh> meshes(count, Mesh(std::shared_ptr<MeshData>()));
+        std::vector<float> transX(count), transY(count), transZ(count), rotX(count), rotY(count), rotZ(count);
+        for (unsigned int i = 0; i < count; i++)
+        {
+            float* pose = meshes[i].mesh6DoF;
+            transX[i] = pose[tX] = translation(gen); transY[i] = pose[tY] = translation(gen); transZ[i] = pose[tZ] = translation(gen);
+            rotX[i] = pose[rX] = angle(gen); rotY[i] = pose[rY] = angle(gen); rotZ[i] = pose[rZ] = angle(gen);
+        }
+        PoseArrays poses = { transX.data(), transY.data(), transZ.data(), rotX.data(), rotY.data(), rotZ.data() };
+
+        std::cout << count << " poses" << std::endl;
+
+        // Baseline
+        std::vector<glm::mat4> reference(count);
+        double baselineMs = timeMedian([&]
+        {
+            for (unsigned int i = 0; i < count; i++)
+                reference[i] = glmPoseToMatrix(meshes[i].mesh6DoF);
+        }, repeats);
+        printRow("glm translate + 3 rotates", count, baselineMs, baselineMs, 0.0f);
+
+        // Closed form, one mesh at a time
+        std::vector<glm::mat4> result(count);
+        double meshMs = timeMedian([&]
+        {
+            for (Mesh& mesh : meshes)
+                mesh.updateModelMatrix();
+        }, repeats);
+        for (unsigned int i = 0; i < count; i++)
+            result[i] = meshes[i].meshMatrix;
+        printRow("Mesh::updateModelMatrix", count, meshMs, baselineMs, maxError(reference, result));
+
+        // Batched kernel on every path compiled in
+        for (PoseKernelPath path : { PoseKernelPath::Scalar, PoseKernelPath::SSE, PoseKernelPath::AVX2 })
+        {
+            if (static_cast<int>(path) > static_cast<int>(getBestPoseKernelPath()))
+                continue;
+
+            std::fill(result.begin(), result.end(), glm::mat4(0.0f));
+            double batchMs = timeMedian([&]
+            {
+                computePoseMatrices(poses, count, result.data(), path);
+            }, repeats);
+            std::string name = std::string("computePoseMatrices ") + getPoseKernelPathName(path);
+            printRow(name.c_str(), count, batchMs, baselineMs, maxError(reference, result));
+        }
+    }
+    return 0;
+}